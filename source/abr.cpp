@@ -0,0 +1,58 @@
+#include "abr.h"
+
+const Rendition abr_ladder[ABR_RUNGS] = {
+    { CODEC_PCM, 1536, "lossless" },
+    { CODEC_MP3, 320, "320k" },
+    { CODEC_OPUS, 128, "128k" },
+    { CODEC_OPUS, 64, "64k" },
+};
+
+#define MIN_TIMED_US    200000    // less network time than this says little about the link
+#define MIN_TIMED_BYTES (32 * 1024)
+
+void abr_reset(AbrState& s) {
+    s.rate_kbps = 0; s.buffer_pct = 0; s.calm_s = 0; s.stall_s = 0;
+}
+
+void abr_update(AbrState& s, const AbrSample& in) {
+    if (in.us >= MIN_TIMED_US && in.bytes >= MIN_TIMED_BYTES) {
+        uint32_t kbps = (uint32_t)((uint64_t)in.bytes * 8000 / in.us);
+        // Falls are believed faster than rises
+        if (!s.rate_kbps) s.rate_kbps = kbps;
+        else if (kbps < s.rate_kbps) s.rate_kbps = (s.rate_kbps + kbps) / 2;
+        else s.rate_kbps = (s.rate_kbps * 7 + kbps * 3) / 10;
+    }
+    s.buffer_pct = in.cap_ms ? (in.buffer_ms > in.cap_ms ? 100 : in.buffer_ms * 100 / in.cap_ms) : 0;
+    s.calm_s = in.stalled ? 0 : s.calm_s + 1;
+    if (!in.buffering) s.stall_s = 0;
+    else if (s.stall_s || in.stalled) s.stall_s++;
+}
+
+int abr_cap_rung(uint32_t max_kbps) {
+    if (!max_kbps) return 0;
+    for (int i = 0; i < ABR_RUNGS; i++) if (abr_ladder[i].kbps <= max_kbps) return i;
+    return ABR_RUNGS - 1;
+}
+
+// Best rung the measured rate carries with headroom
+static int fitting_rung(const AbrState& s, int cap) {
+    for (int i = cap; i < ABR_RUNGS; i++) if ((uint64_t)abr_ladder[i].kbps * 100 <= (uint64_t)s.rate_kbps * ABR_HEADROOM_PCT) return i;
+    return ABR_RUNGS - 1;
+}
+
+int abr_choose(const AbrState& s, int rung, int cap) {
+    if (rung < cap) rung = cap;
+    if (!s.rate_kbps) return rung;
+    int fit = fitting_rung(s, cap);
+    if (fit > rung) return fit;
+    // Stalling on a rung the rate should carry: the estimate is stale
+    if (s.stall_s && rung < ABR_RUNGS - 1) return rung + 1;
+    if (fit < rung && s.calm_s >= ABR_CALM_S && s.buffer_pct >= 75) return rung - 1;
+    return rung;
+}
+
+int abr_reopen(const AbrState& s, int rung, int cap) {
+    if (s.stall_s < ABR_STALL_S) return -1;
+    int next = abr_choose(s, rung, cap);
+    return next > rung ? next : -1;
+}
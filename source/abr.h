@@ -0,0 +1,42 @@
+#pragma once
+#include <stdint.h>
+#include "codec.h"
+
+// --- Adaptive bitrate ---
+// Picks the rung of a rendition ladder to stream from the measured download
+// rate and the audio buffered ahead of the DSP. A new rung applies from the
+// next stream opened; the player also reopens the playing track lower down
+// when it keeps stalling. Platform-free so tools/ can build it on the host.
+#define ABR_RUNGS        4
+#define ABR_HEADROOM_PCT 70 // a rung fits when it needs at most this much of the measured rate
+#define ABR_CALM_S       20 // stall-free seconds before stepping up a rung
+#define ABR_STALL_S      2  // seconds into a stall before reopening mid-track
+
+// What a stream asks the server for: a codec, at kbps where it has a bitrate
+struct Rendition { Codec codec; uint32_t kbps; const char* name; };
+
+extern const Rendition abr_ladder[ABR_RUNGS]; // best first
+
+struct AbrSample {
+    uint32_t bytes, us;        // downloaded this second, and the time spent receiving it
+    uint32_t buffer_ms, cap_ms; // audio buffered, and room for it
+    bool stalled;              // an underrun or rebuffer started this second
+    bool buffering;            // playback is paused to refill
+};
+
+struct AbrState {
+    uint32_t rate_kbps;  // smoothed download rate, 0 until measured
+    uint32_t buffer_pct; // last buffer level
+    uint32_t calm_s;     // seconds since the last stall
+    uint32_t stall_s;    // how long the current stall has lasted, 0 if none
+};
+
+void abr_reset(AbrState& s);
+void abr_update(AbrState& s, const AbrSample& in); // once a second
+int abr_cap_rung(uint32_t max_kbps);               // best rung within max_kbps, 0 for no cap
+
+// Rung for the next stream after one at rung: down as far as the rate says,
+// up one at a time once playback has been calm with a full buffer
+int abr_choose(const AbrState& s, int rung, int cap);
+// Lower rung to reopen the playing stream at right now, or -1
+int abr_reopen(const AbrState& s, int rung, int cap);
@@ -0,0 +1,313 @@
+#include "art.h"
+#include "net.h"
+#include "trace.h"
+#include <jpeglib.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define ART_MAX_DOWNLOAD (1024 * 1024)
+
+struct ArtJob { std::string key, url; u16 max_size; };
+struct ArtDone { std::string key; ArtTexture* art; }; // art is NULL if the fetch failed
+struct ArtEntry { std::string key; ArtTexture* art; u32 last_use; bool pending; };
+
+ArtConfig art_config = { 2048 };
+
+static std::vector<ArtJob> jobs;
+static std::vector<ArtDone> done;
+static LightLock lock;
+static LightEvent job_event;
+static Thread worker = NULL;
+static volatile bool worker_run = false;
+static ArtStats stats;
+
+// Decoded covers, owned by the main thread
+static std::vector<ArtEntry> cache;
+static u32 frame = 0;
+
+// Morton order inside 8x8 tiles: column part (tile index * 64 + x bits) and row part (y bits).
+static u16 swz_x[ART_MAX_SIZE];
+static u8 swz_y[8];
+static bool swz_ready = false;
+
+static void init_swizzle() {
+    if (swz_ready) return;
+    for (u32 x = 0; x < ART_MAX_SIZE; x++) swz_x[x] = ((x >> 3) << 6) | (x & 1) | ((x & 2) << 1) | ((x & 4) << 2);
+    for (u32 y = 0; y < 8; y++) swz_y[y] = ((y & 1) << 1) | ((y & 2) << 2) | ((y & 4) << 3);
+    swz_ready = true;
+}
+
+static u16 pow2_at_least(u32 v) { u16 p = 8; while (p < v) p <<= 1; return p; }
+
+// --- JPEG -> tiled RGBA8 ---
+// libjpeg's default error handler calls exit(); bail out through longjmp instead.
+struct JpegErr { jpeg_error_mgr mgr; jmp_buf jb; };
+static void jpeg_bail(j_common_ptr c) { longjmp(((JpegErr*)c->err)->jb, 1); }
+
+// Where a decode lands: tex at (x, y), both multiples of 8. place() is
+// called once the scaled size is known and returns false to give up.
+struct JpegTarget {
+    bool (*place)(JpegTarget* t, u32 w, u32 h);
+    C3D_Tex* tex;
+    u16 x, y;
+    bool flush_all; // else only the tile rows written
+};
+
+static bool decode_jpeg(const u8* data, size_t size, u16 max_size, JpegTarget* t, u16* out_w, u16* out_h) {
+    if (size < 100) return false;
+    if (max_size > ART_MAX_SIZE) max_size = ART_MAX_SIZE;
+    init_swizzle();
+    u64 t0 = svcGetSystemTick();
+    jpeg_decompress_struct cinfo;
+    JpegErr err;
+    cinfo.err = jpeg_std_error(&err.mgr); err.mgr.error_exit = jpeg_bail;
+    u8* volatile row_buf = NULL;
+    if (setjmp(err.jb)) {
+        jpeg_destroy_decompress(&cinfo);
+        free(row_buf);
+        return false;
+    }
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, (unsigned char*)data, size);
+    if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) { jpeg_destroy_decompress(&cinfo); return false; }
+
+    // Let the IDCT do the downscale: largest M/8 that fits the box
+    u32 big = cinfo.image_width > cinfo.image_height ? cinfo.image_width : cinfo.image_height;
+    cinfo.scale_denom = 8; cinfo.scale_num = 8;
+    while (cinfo.scale_num > 1 && (big * cinfo.scale_num + 7) / 8 > max_size) cinfo.scale_num--;
+    cinfo.dct_method = JDCT_IFAST;
+#ifdef JCS_EXTENSIONS
+    cinfo.out_color_space = JCS_EXT_ABGR; // byte order GPU_RGBA8 wants, no repacking
+#else
+    cinfo.out_color_space = JCS_RGB;
+#endif
+    jpeg_start_decompress(&cinfo);
+
+    u32 w = cinfo.output_width < max_size ? cinfo.output_width : max_size;
+    u32 h = cinfo.output_height < max_size ? cinfo.output_height : max_size;
+    if (!t->place(t, w, h)) { jpeg_destroy_decompress(&cinfo); return false; }
+    u8* row = (u8*)malloc(cinfo.output_width * cinfo.output_components); row_buf = row;
+    if (!row) longjmp(err.jb, 1);
+
+    u32 tiles_across = t->tex->width >> 3;
+    u32* dst = (u32*)t->tex->data + (t->x >> 3) * 64;
+    while (cinfo.output_scanline < h) {
+        u32 y = cinfo.output_scanline, ty = t->y + y;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+        u32* line = dst + (ty >> 3) * tiles_across * 64 + swz_y[ty & 7];
+#ifdef JCS_EXTENSIONS
+        const u32* px = (const u32*)row;
+        for (u32 x = 0; x < w; x++) line[swz_x[x]] = px[x];
+#else
+        for (u32 x = 0; x < w; x++) line[swz_x[x]] = 0xFF | (row[x * 3 + 2] << 8) | (row[x * 3 + 1] << 16) | (row[x * 3] << 24);
+#endif
+    }
+    if (cinfo.output_scanline < cinfo.output_height) jpeg_abort_decompress(&cinfo);
+    else jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    free(row);
+    if (t->flush_all) GSPGPU_FlushDataCache(t->tex->data, t->tex->size);
+    else {
+        u32 stripe = tiles_across * 64 * sizeof(u32); // bytes per row of tiles
+        GSPGPU_FlushDataCache((u8*)t->tex->data + (t->y >> 3) * stripe, ((h + 7) >> 3) * stripe);
+    }
+    *out_w = w; *out_h = h;
+
+    u64 t1 = svcGetSystemTick();
+    u32 us = (u32)((t1 - t0) * 1000000 / SYSCLOCK_ARM11);
+    trace_span(TRACE_JPEG, TRACE_LANE_ART, t0, t1, w);
+    LightLock_Lock(&lock);
+    stats.decodes++; stats.last_us = us; stats.total_us += us;
+    if (us > stats.max_us) stats.max_us = us;
+    LightLock_Unlock(&lock);
+    return true;
+}
+
+struct NewTexture { JpegTarget t; ArtTexture* art; };
+
+static bool place_new(JpegTarget* t, u32 w, u32 h) {
+    NewTexture* n = (NewTexture*)t;
+    u16 tw = pow2_at_least(w), th = pow2_at_least(h);
+    ArtTexture* a = new ArtTexture;
+    if (!C3D_TexInit(&a->tex, tw, th, GPU_RGBA8)) { delete a; return false; }
+    C3D_TexSetFilter(&a->tex, GPU_LINEAR, GPU_LINEAR);
+    memset(a->tex.data, 0, a->tex.size);
+    n->art = a; t->tex = &a->tex;
+    return true;
+}
+
+ArtTexture* art_decode_jpeg(const u8* data, size_t size, u16 max_size) {
+    NewTexture n; n.t.place = place_new; n.t.tex = NULL; n.t.x = n.t.y = 0; n.t.flush_all = true; n.art = NULL;
+    u16 w, h;
+    if (!decode_jpeg(data, size, max_size, &n.t, &w, &h)) { art_free(n.art); return NULL; }
+    ArtTexture* a = n.art;
+    a->width = w; a->height = h;
+    a->sub.width = w; a->sub.height = h;
+    a->sub.left = 0.0f; a->sub.top = 1.0f;
+    a->sub.right = (float)w / a->tex.width; a->sub.bottom = 1.0f - (float)h / a->tex.height;
+    a->image.tex = &a->tex; a->image.subtex = &a->sub;
+    return a;
+}
+
+static bool place_fixed(JpegTarget*, u32, u32) { return true; }
+
+bool art_decode_jpeg_at(const u8* data, size_t size, u16 max_size, C3D_Tex* tex, u16 x, u16 y, u16* w, u16* h) {
+    JpegTarget t; t.place = place_fixed; t.tex = tex; t.x = x; t.y = y; t.flush_all = false;
+    return decode_jpeg(data, size, max_size, &t, w, h);
+}
+
+void art_free(ArtTexture* art) {
+    if (!art) return;
+    C3D_TexDelete(&art->tex);
+    delete art;
+}
+
+// --- Worker ---
+struct DlBuf { u8* data; size_t len, cap; };
+
+static size_t dl_write(void* p, size_t s, size_t n, void* u) {
+    DlBuf* b = (DlBuf*)u; size_t t = s * n;
+    if (b->len + t > ART_MAX_DOWNLOAD) return 0; // abort oversized bodies
+    if (b->len + t > b->cap) {
+        size_t cap = b->cap ? b->cap * 2 : 64 * 1024;
+        while (cap < b->len + t) cap *= 2;
+        u8* grown = (u8*)realloc(b->data, cap);
+        if (!grown) return 0;
+        b->data = grown; b->cap = cap;
+    }
+    memcpy(b->data + b->len, p, t); b->len += t;
+    return t;
+}
+
+static void art_worker(void*) {
+    CURL* c = curl_easy_init(); // kept across jobs so the connection stays open
+    while (worker_run) {
+        LightLock_Lock(&lock);
+        bool have = !jobs.empty();
+        ArtJob job; if (have) { job = jobs.front(); jobs.erase(jobs.begin()); }
+        LightLock_Unlock(&lock);
+        if (!have) { LightEvent_WaitTimeout(&job_event, 500000000LL); continue; }
+
+        DlBuf b = { NULL, 0, 0 };
+        curl_easy_reset(c); net_setup(c, &worker_run);
+        curl_easy_setopt(c, CURLOPT_URL, job.url.c_str());
+        curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, dl_write); curl_easy_setopt(c, CURLOPT_WRITEDATA, &b);
+        ArtTexture* art = NULL; long code = 0;
+        if (net_perform(c, NET_ART, &code) == CURLE_OK && code == 200) art = art_decode_jpeg(b.data, b.len, job.max_size);
+        free(b.data);
+
+        LightLock_Lock(&lock);
+        ArtDone d; d.key = job.key; d.art = art;
+        done.push_back(d);
+        LightLock_Unlock(&lock);
+    }
+    curl_easy_cleanup(c);
+}
+
+void art_init() {
+    LightLock_Init(&lock);
+    LightEvent_Init(&job_event, RESET_ONESHOT);
+    s32 prio = 0x30; svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+    worker_run = true;
+    worker = threadCreate(art_worker, NULL, 32 * 1024, prio + 1, -2, false);
+}
+
+void art_exit() {
+    if (worker) { worker_run = false; LightEvent_Signal(&job_event); threadJoin(worker, U64_MAX); threadFree(worker); worker = NULL; }
+    art_clear_pending();
+    for (ArtDone& d : done) art_free(d.art);
+    done.clear();
+    for (ArtEntry& e : cache) art_free(e.art);
+    cache.clear();
+}
+
+ArtStats art_get_stats() {
+    LightLock_Lock(&lock);
+    ArtStats s = stats;
+    LightLock_Unlock(&lock);
+    return s;
+}
+
+void art_request(const char* key, const char* url, u16 max_size) {
+    LightLock_Lock(&lock);
+    for (size_t i = 0; i < jobs.size(); i++) if (jobs[i].key == key) { jobs.erase(jobs.begin() + i); break; }
+    ArtJob j; j.key = key; j.url = url; j.max_size = max_size;
+    jobs.insert(jobs.begin(), j);
+    LightLock_Unlock(&lock);
+    LightEvent_Signal(&job_event);
+}
+
+void art_clear_pending() {
+    LightLock_Lock(&lock);
+    std::vector<ArtJob> dropped; dropped.swap(jobs);
+    LightLock_Unlock(&lock);
+    // Forget the cache slots so a later art_want() asks again
+    for (ArtJob& j : dropped)
+        for (size_t i = 0; i < cache.size(); i++) if (cache[i].pending && cache[i].key == j.key) { cache.erase(cache.begin() + i); break; }
+}
+
+bool art_take(char* key, size_t key_len, ArtTexture** out) {
+    LightLock_Lock(&lock);
+    bool have = !done.empty();
+    if (have) {
+        strncpy(key, done.front().key.c_str(), key_len - 1); key[key_len - 1] = '\0';
+        *out = done.front().art;
+        done.erase(done.begin());
+    }
+    LightLock_Unlock(&lock);
+    return have;
+}
+
+// --- Cache ---
+static ArtEntry* find_entry(const char* key) {
+    for (ArtEntry& e : cache) if (e.key == key) return &e;
+    return NULL;
+}
+
+void art_want(const char* key, const char* url, u16 max_size) {
+    if (find_entry(key)) return;
+    ArtEntry e; e.key = key; e.art = NULL; e.last_use = frame; e.pending = true;
+    cache.push_back(e);
+    art_request(key, url, max_size);
+}
+
+const C2D_Image* art_get(const char* key) {
+    ArtEntry* e = find_entry(key);
+    if (!e) return NULL;
+    e->last_use = frame;
+    return e->art ? &e->art->image : NULL;
+}
+
+// Evicts least recently drawn covers over the budget. Anything drawn last
+// frame stays, so a small budget can overshoot but never blanks the screen.
+static void evict() {
+    size_t total = 0, budget = (size_t)art_config.cache_kb * 1024;
+    for (ArtEntry& e : cache) if (e.art) total += e.art->tex.size;
+    while (total > budget || cache.size() > ART_CACHE_ENTRIES) {
+        int victim = -1;
+        for (size_t i = 0; i < cache.size(); i++) {
+            const ArtEntry& e = cache[i];
+            if (e.pending || e.last_use + 1 >= frame) continue;
+            if (total <= budget && e.art) continue; // only trimming failed lookups
+            if (victim < 0 || e.last_use < cache[victim].last_use) victim = i;
+        }
+        if (victim < 0) break;
+        if (cache[victim].art) { total -= cache[victim].art->tex.size; art_free(cache[victim].art); }
+        cache.erase(cache.begin() + victim);
+    }
+}
+
+void art_collect() {
+    frame++;
+    char key[64]; ArtTexture* art;
+    while (art_take(key, sizeof(key), &art)) {
+        ArtEntry* e = find_entry(key);
+        if (!e) { art_free(art); continue; }
+        art_free(e->art);
+        e->art = art; e->pending = false; // a failed fetch stays as an empty entry
+    }
+    evict();
+}
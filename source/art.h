@@ -0,0 +1,51 @@
+#pragma once
+#include <3ds.h>
+#include <citro2d.h>
+
+// --- Album art pipeline ---
+// A worker thread downloads cover JPEGs and decodes them straight into tiled
+// textures; the render loop collects finished ones with art_take(). Requests
+// are served newest first. On top sits a byte-budgeted LRU cache keyed by
+// album (or item) Id, so each cover is fetched and decoded once.
+#define ART_MAX_SIZE      256
+#define ART_CACHE_ENTRIES 64
+
+struct ArtConfig {
+    u32 cache_kb; // decoded texture budget
+};
+
+extern ArtConfig art_config;
+
+struct ArtStats {
+    u32 decodes;
+    u32 last_us, max_us; // JPEG decode and tiling, per cover
+    u64 total_us;
+};
+
+struct ArtTexture {
+    C3D_Tex tex;
+    Tex3DS_SubTexture sub;
+    C2D_Image image;
+    u16 width, height; // decoded size, at most the requested box
+};
+
+void art_init();
+void art_exit();
+
+void art_request(const char* key, const char* url, u16 max_size);
+void art_clear_pending();
+bool art_take(char* key, size_t key_len, ArtTexture** out); // caller owns *out; NULL on failure
+void art_free(ArtTexture* art);
+
+// Cache, main thread only. art_collect() must run after C3D_FrameBegin, when
+// the GPU is done with last frame's textures.
+void art_want(const char* key, const char* url, u16 max_size); // no-op if cached or in flight
+const C2D_Image* art_get(const char* key);                     // NULL until decoded
+void art_collect();
+
+// Synchronous decode, exposed for callers that already hold the JPEG bytes
+ArtTexture* art_decode_jpeg(const u8* data, size_t size, u16 max_size);
+// Decodes into an existing RGBA8 texture with the top-left at (x, y), both
+// multiples of 8, and flushes just the rows written. The area must be free.
+bool art_decode_jpeg_at(const u8* data, size_t size, u16 max_size, C3D_Tex* tex, u16 x, u16 y, u16* w, u16* h);
+ArtStats art_get_stats();
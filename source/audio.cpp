@@ -0,0 +1,264 @@
+#include "audio.h"
+#include "trace.h"
+
+AudioConfig audio_config = { 3000, 500, 6000 };
+
+static u8* wave_mem = NULL;
+static ndspWaveBuf wave_buf[NUM_BUFFERS];
+static int write_node = 0;
+
+// cur feeds the DSP; next is appended sample-for-sample once cur runs out
+static PcmRing *cur = NULL, *next = NULL;
+static int boundary_node = -1;          // waveBuf holding the first samples of the new track
+static volatile bool switched = false;  // boundary reached the speaker, see audio_take_switch()
+
+static Thread feeder = NULL;
+static volatile bool feeder_run = false;
+static LightEvent feed_event, space_event;
+static LightLock lock;
+
+// Track frame of each waveBuf's first sample, to turn the DSP's play position
+// into a track position. The boundary node's is negative: it starts in the old track.
+static s64 node_start[NUM_BUFFERS];
+static u64 ring_frame = 0; // track frame of cur's next unread sample
+
+static u64 seek_tick = 0;   // a seek is waiting for its first block to play
+static int seek_node = -1;  // that block
+
+static bool buffering = false, user_paused = false, chn_paused = false, seeking = false;
+static volatile bool drained = false;
+static AudioStats stats;
+
+static size_t ms_to_bytes(u32 ms) { return (size_t)ms * (HARDWARE_RATE / 1000) * FRAME_BYTES; }
+
+static bool wave_busy(const ndspWaveBuf* wb) { return wb->status == NDSP_WBUF_QUEUED || wb->status == NDSP_WBUF_PLAYING; }
+
+// Fills one waveBuf, crossing into the queued ring mid-block when cur ends.
+// *cross_at is the byte offset where the new track starts, if it does.
+static size_t fill_block(u8* dst, size_t* cross_at) {
+    size_t got = 0;
+    for (;;) {
+        bool eof = cur->eof.load();
+        size_t n = cur->fill(); if (n > AUDIO_BUF_SIZE - got) n = AUDIO_BUF_SIZE - got;
+        n -= n % FRAME_BYTES;
+        got += cur->read(dst + got, n);
+        if (got == AUDIO_BUF_SIZE || !eof || cur->fill() >= FRAME_BYTES || !next) break;
+        cur = next; next = NULL; *cross_at = got;
+    }
+    return got;
+}
+
+// The waveBuf the DSP is on, and how far into it
+static void update_position() {
+    u16 seq = ndspChnGetWaveBufSeq(0);
+    for (int i = 0; i < NUM_BUFFERS; i++) {
+        const ndspWaveBuf* wb = &wave_buf[i];
+        if (wb->status == NDSP_WBUF_FREE || wb->sequence_id != seq) continue;
+        s64 pos = node_start[i] + (wb->status == NDSP_WBUF_PLAYING ? ndspChnGetSamplePos(0) : wb->status == NDSP_WBUF_DONE ? wb->nsamples : 0);
+        stats.position = pos < 0 ? 0 : pos;
+        break;
+    }
+    if (seek_node >= 0 && wave_buf[seek_node].status != NDSP_WBUF_QUEUED) {
+        u32 ms = (u32)((svcGetSystemTick() - seek_tick) * 1000 / SYSCLOCK_ARM11);
+        stats.seeks++; stats.seek_ms = ms;
+        trace_span(TRACE_SEEK, TRACE_LANE_AUDIO, seek_tick, svcGetSystemTick());
+        if (ms > stats.seek_max_ms) stats.seek_max_ms = ms;
+        seek_node = -1; seek_tick = 0;
+    }
+}
+
+// Runs on the feeder thread, once per DSP frame.
+static void feed() {
+    u64 t0 = svcGetSystemTick();
+    LightLock_Lock(&lock);
+    if (!cur) { LightLock_Unlock(&lock); return; }
+
+    int queued = 0;
+    for (int i = 0; i < NUM_BUFFERS; i++) if (wave_busy(&wave_buf[i])) queued++;
+    if (boundary_node >= 0 && wave_buf[boundary_node].status != NDSP_WBUF_QUEUED) { boundary_node = -1; switched = true; }
+    update_position();
+
+    bool eof = cur->eof.load() && !next;
+    size_t fill = cur->fill() + (next ? next->fill() : 0);
+
+    if (!buffering && !eof && !user_paused && !seeking) { // a seek empties the DSP queue on purpose
+        if (queued == 0) { stats.underruns++; buffering = true; trace_instant(TRACE_UNDERRUN, TRACE_LANE_AUDIO); }
+        else if (fill + queued * AUDIO_BUF_SIZE < ms_to_bytes(audio_config.rebuffer_ms)) {
+            stats.rebuffers++; buffering = true; trace_instant(TRACE_REBUFFER, TRACE_LANE_AUDIO);
+        }
+    }
+    if (buffering) {
+        size_t target = ms_to_bytes(audio_config.prebuffer_ms);
+        if (eof || fill >= target || cur->space() < AUDIO_BUF_SIZE) buffering = false;
+    }
+
+    bool consumed = false;
+    while (!buffering) {
+        ndspWaveBuf* wb = &wave_buf[write_node];
+        if (wave_busy(wb)) break;
+        // Partial blocks only at the very end, or when the next track can't top one up yet
+        size_t avail = cur->fill() + (cur->eof.load() && next ? next->fill() : 0);
+        if (avail < AUDIO_BUF_SIZE && !cur->eof.load()) break;
+        size_t cross_at = AUDIO_BUF_SIZE;
+        size_t n = fill_block((u8*)wb->data_vaddr, &cross_at);
+        if (!n) break;
+        DSP_FlushDataCache(wb->data_vaddr, n);
+        wb->nsamples = n / FRAME_BYTES;
+        ndspChnWaveBufAdd(0, wb);
+        if (cross_at < AUDIO_BUF_SIZE) {
+            boundary_node = write_node; stats.samples_queued = (n - cross_at) / FRAME_BYTES;
+            node_start[write_node] = -(s64)(cross_at / FRAME_BYTES); ring_frame = stats.samples_queued;
+        } else {
+            stats.samples_queued += wb->nsamples;
+            node_start[write_node] = ring_frame; ring_frame += wb->nsamples;
+        }
+        if (seek_tick && seek_node < 0) seek_node = write_node;
+        write_node = (write_node + 1) % NUM_BUFFERS;
+        queued++; consumed = true; seeking = false;
+    }
+    if (consumed) {
+        LightEvent_Signal(&space_event);
+        trace_span(TRACE_FEED, TRACE_LANE_AUDIO, t0, svcGetSystemTick(), queued);
+        trace_counter(TRACE_DSP_QUEUED, TRACE_LANE_AUDIO, queued);
+        trace_counter(TRACE_RING_MS, TRACE_LANE_AUDIO, (cur->fill() + (next ? next->fill() : 0)) / (HARDWARE_RATE / 1000 * FRAME_BYTES));
+    }
+
+    bool pause = user_paused || buffering;
+    if (pause != chn_paused) { ndspChnSetPaused(0, pause); chn_paused = pause; }
+    drained = cur->eof.load() && !next && cur->fill() < FRAME_BYTES && queued == 0;
+    LightLock_Unlock(&lock);
+}
+
+static void feeder_thread(void*) {
+    while (feeder_run) {
+        LightEvent_Wait(&feed_event);
+        feed();
+    }
+}
+
+bool audio_init() {
+    if (R_FAILED(ndspInit())) return false;
+    wave_mem = (u8*)linearAlloc(AUDIO_BUF_SIZE * NUM_BUFFERS);
+    if (!wave_mem) return false;
+    memset(wave_buf, 0, sizeof(wave_buf));
+    for (int i = 0; i < NUM_BUFFERS; i++) wave_buf[i].data_vaddr = wave_mem + (i * AUDIO_BUF_SIZE);
+    memset(&stats, 0, sizeof(stats));
+
+    LightLock_Init(&lock);
+    LightEvent_Init(&feed_event, RESET_ONESHOT);
+    LightEvent_Init(&space_event, RESET_PULSE); // current and prefetching producers may both wait
+    ndspSetCallback([](void*) { LightEvent_Signal(&feed_event); }, NULL);
+
+    // Above the main thread so UI work can't starve the DSP queue
+    s32 prio = 0x30; svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+    feeder_run = true;
+    feeder = threadCreate(feeder_thread, NULL, 16 * 1024, prio - 1, -2, false);
+    return feeder != NULL;
+}
+
+void audio_exit() {
+    if (feeder) { feeder_run = false; LightEvent_Signal(&feed_event); threadJoin(feeder, U64_MAX); threadFree(feeder); feeder = NULL; }
+    ndspSetCallback(NULL, NULL);
+    ndspChnReset(0);
+    if (wave_mem) { linearFree(wave_mem); wave_mem = NULL; }
+    ndspExit();
+}
+
+size_t audio_ring_bytes() {
+    u32 ring_ms = audio_config.ring_ms;
+    if (ring_ms < audio_config.prebuffer_ms + 1000) ring_ms = audio_config.prebuffer_ms + 1000;
+    return ms_to_bytes(ring_ms);
+}
+
+// Drops everything queued on the DSP. Lock held.
+static void restart_channel() {
+    ndspChnReset(0); ndspChnInitParams(0); ndspChnSetFormat(0, NDSP_FORMAT_STEREO_PCM16); ndspChnSetRate(0, HARDWARE_RATE);
+    for (int i = 0; i < NUM_BUFFERS; i++) wave_buf[i].status = NDSP_WBUF_FREE;
+    write_node = 0; boundary_node = -1; seek_node = -1; chn_paused = false;
+}
+
+void audio_play(PcmRing* ring, u64 start_frame, u64 seek_start) {
+    LightLock_Lock(&lock);
+    restart_channel();
+    cur = ring; next = NULL;
+    stats.samples_queued = 0; stats.position = ring_frame = start_frame;
+    seek_tick = seek_start;
+    buffering = true; user_paused = false; drained = false; switched = false; seeking = false;
+    LightLock_Unlock(&lock);
+}
+
+// Serves a seek from the ring when the target is already in it: the queued
+// waveBufs go and the ring skips ahead, so playback resumes within a DSP
+// frame or two instead of refetching. Backward seeks can't be served, since
+// the producer may already be overwriting what was read.
+bool audio_seek(u64 frame) {
+    LightLock_Lock(&lock);
+    size_t skip = frame >= ring_frame ? (frame - ring_frame) * FRAME_BYTES : 0;
+    bool ok = cur && frame >= ring_frame && boundary_node < 0 && !switched
+        && (cur->fill() >= skip + 2 * AUDIO_BUF_SIZE || (cur->eof.load() && cur->fill() > skip));
+    if (ok) {
+        cur->skip(skip);
+        restart_channel();
+        stats.position = ring_frame = frame;
+        seek_tick = user_paused ? 0 : svcGetSystemTick(); // a paused seek has no latency to speak of
+        buffering = false; drained = false; seeking = true;
+    }
+    LightLock_Unlock(&lock);
+    if (ok) LightEvent_Signal(&feed_event);
+    return ok;
+}
+
+bool audio_queue_next(PcmRing* ring) {
+    LightLock_Lock(&lock);
+    // Once the feeder has crossed over, the queued ring is already playing
+    bool ok = cur != NULL && cur != ring && boundary_node < 0 && !switched;
+    if (ok) next = ring;
+    LightLock_Unlock(&lock);
+    LightEvent_Signal(&feed_event);
+    return ok;
+}
+
+bool audio_take_switch() {
+    if (!switched) return false;
+    switched = false;
+    return true;
+}
+
+size_t audio_write(PcmRing* ring, const void* data, size_t len, volatile bool* run) {
+    const u8* p = (const u8*)data; size_t done = 0;
+    while (done < len && *run) {
+        done += ring->write(p + done, len - done);
+        if (done < len) LightEvent_WaitTimeout(&space_event, 20000000);
+    }
+    return done;
+}
+
+void audio_end_stream(PcmRing* ring) { ring->eof.store(true); LightEvent_Signal(&feed_event); }
+
+// Producers must already be stopped.
+void audio_stop() {
+    LightLock_Lock(&lock);
+    cur = next = NULL; boundary_node = -1;
+    drained = false; switched = false;
+    ndspChnReset(0);
+    LightLock_Unlock(&lock);
+}
+
+void audio_set_paused(bool paused) {
+    LightLock_Lock(&lock);
+    user_paused = paused;
+    LightLock_Unlock(&lock);
+    LightEvent_Signal(&feed_event);
+}
+
+bool audio_drained() { return drained; }
+
+AudioStats audio_get_stats() {
+    LightLock_Lock(&lock);
+    AudioStats s = stats;
+    s.ring_fill = cur ? cur->fill() : 0; s.ring_size = cur ? cur->size : 0; s.buffering = cur && buffering;
+    s.dsp_queued = 0;
+    for (int i = 0; i < NUM_BUFFERS; i++) if (wave_busy(&wave_buf[i])) s.dsp_queued++;
+    LightLock_Unlock(&lock);
+    return s;
+}
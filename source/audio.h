@@ -0,0 +1,51 @@
+#pragma once
+#include <3ds.h>
+#include "pcm_ring.h"
+
+// --- NDSP output stage ---
+// Producers push PCM into a PcmRing with audio_write(); a feeder thread woken
+// by the NDSP frame callback moves whole blocks from the playing ring into
+// waveBufs. A second ring can be queued and is spliced in gaplessly.
+#define AUDIO_BUF_SIZE  (16 * 1024)
+#define NUM_BUFFERS     8
+#define HARDWARE_RATE   48000
+#define FRAME_BYTES     4 // stereo s16
+
+struct AudioConfig {
+    u32 prebuffer_ms; // buffered audio needed before starting/resuming
+    u32 rebuffer_ms;  // pause and refill when ring + DSP queue drop below this
+    u32 ring_ms;      // ring capacity
+};
+
+struct AudioStats {
+    u32 underruns;      // DSP ran dry while the stream was still open
+    u32 rebuffers;      // low watermark hit, playback paused to refill
+    u64 samples_queued; // handed to NDSP for the current track
+    u64 position;       // frames of the current track that have reached the speaker
+    u32 seeks, seek_ms, seek_max_ms; // seek-to-audio latency, last and worst
+    u32 ring_fill, ring_size;
+    u32 dsp_queued;     // waveBufs queued or playing, of NUM_BUFFERS
+    bool buffering;
+};
+
+extern AudioConfig audio_config;
+
+bool audio_init();
+void audio_exit();
+
+size_t audio_ring_bytes(); // PCM ring size producers should allocate
+
+// Hard start: resets the channel and prebuffers. start_frame is where the
+// ring begins in the track; seek_start, if set, is the svcGetSystemTick() a
+// seek that reopened the stream began at, to time it to the first audio.
+void audio_play(PcmRing* ring, u64 start_frame = 0, u64 seek_start = 0);
+bool audio_seek(u64 frame);            // within audio already in the ring; false if it isn't there
+bool audio_queue_next(PcmRing* ring);  // NULL cancels; false if the old one already started
+bool audio_take_switch();              // true once per queued ring reaching the speaker
+size_t audio_write(PcmRing* ring, const void* data, size_t len, volatile bool* run);
+void audio_end_stream(PcmRing* ring);
+void audio_stop();
+
+void audio_set_paused(bool paused);
+bool audio_drained();
+AudioStats audio_get_stats();
@@ -0,0 +1,381 @@
+#include "cache.h"
+#include "net.h"
+#include <dirent.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#define CACHE_INDEX     CACHE_DIR "/index.bin"
+#define CACHE_MAGIC     0x4843434A // "JCCH"
+#define CACHE_VERSION   1
+#define WRITER_RING     (512 * 1024)
+#define COPY_CHUNK      (16 * 1024)
+
+CacheConfig cache_config = { 256 };
+
+struct CacheEntry {
+    char key[CACHE_KEY_LEN];
+    u32 size;
+    u32 last_used; // use_clock value, not wall time
+    u8 pinned, in_use;
+    u8 pad[2];
+};
+
+struct IndexHeader { u32 magic, version, count, clock; };
+
+struct PinJob { std::string key, url; };
+
+static std::vector<CacheEntry> entries;
+static u64 total_bytes = 0;
+static u32 use_clock = 0;
+static bool dirty = false;
+static volatile u32 generation = 0; // bumped whenever what cache_item_state() reports may change
+struct Committing { std::string key; bool pinned; };
+static std::vector<Committing> committing; // keys between the two halves of commit()
+static LightLock lock;
+
+static std::vector<PinJob> pin_jobs;
+static Thread pin_thread = NULL;
+static volatile bool pin_run = false, pin_busy = false;
+static LightEvent pin_event;
+
+static void entry_path(char* out, size_t n, const char* key, const char* ext) { snprintf(out, n, "%s/%s.%s", CACHE_DIR, key, ext); }
+
+// Every download writes its own "<key>.<n>.part", so the stream tee and the
+// pin worker fetching the same key never share a file
+static u32 part_seq = 0;
+static void part_path(char* out, size_t n, const char* key) {
+    snprintf(out, n, "%s/%s.%lu.part", CACHE_DIR, key, (unsigned long)__atomic_add_fetch(&part_seq, 1, __ATOMIC_RELAXED));
+}
+
+static int find(const char* key) {
+    for (size_t i = 0; i < entries.size(); i++) if (!strcmp(entries[i].key, key)) return (int)i;
+    return -1;
+}
+
+// Keys are "<item id>-<params hash>"
+static bool is_variant(const CacheEntry& e, const char* item_id) {
+    size_t n = strlen(item_id);
+    return !strncmp(e.key, item_id, n) && e.key[n] == '-';
+}
+
+// The index file is written outside lock so callers don't hold it across SD
+// I/O: take a snapshot under lock, write it after unlocking. A snapshot older
+// than one already written is dropped.
+struct IndexSnapshot { u32 seq; IndexHeader h; std::vector<CacheEntry> entries; };
+static LightLock index_lock; // serialises index file writes
+static u32 index_seq = 0, index_written = 0;
+
+static void snapshot_index(IndexSnapshot& s) {
+    s.seq = ++index_seq;
+    s.h.magic = CACHE_MAGIC; s.h.version = CACHE_VERSION; s.h.count = (u32)entries.size(); s.h.clock = use_clock;
+    s.entries = entries;
+    dirty = false;
+}
+
+static void write_index(const IndexSnapshot& s) {
+    LightLock_Lock(&index_lock);
+    if (s.seq > index_written) {
+        index_written = s.seq;
+        FILE* f = fopen(CACHE_INDEX, "wb");
+        if (f) {
+            fwrite(&s.h, sizeof(s.h), 1, f);
+            if (!s.entries.empty()) fwrite(s.entries.data(), sizeof(CacheEntry), s.entries.size(), f);
+            fclose(f);
+        }
+    }
+    LightLock_Unlock(&index_lock);
+}
+
+// Drops an entry from the index; its file goes on `doomed` for deleting after unlocking
+static void drop_entry(size_t i, std::vector<std::string>& doomed) {
+    char path[256]; entry_path(path, sizeof(path), entries[i].key, "bin");
+    doomed.push_back(path);
+    total_bytes -= entries[i].size;
+    entries.erase(entries.begin() + i);
+    dirty = true; generation++;
+}
+
+// Evicts least recently used, unpinned, idle entries until `need` more bytes fit.
+static bool make_room(u64 need, std::vector<std::string>& doomed) {
+    u64 cap = (u64)cache_config.max_mb * 1024 * 1024;
+    while (total_bytes + need > cap) {
+        int victim = -1;
+        for (size_t i = 0; i < entries.size(); i++) {
+            const CacheEntry& e = entries[i];
+            if (e.pinned || e.in_use) continue;
+            if (victim < 0 || e.last_used < entries[victim].last_used) victim = (int)i;
+        }
+        if (victim < 0) return false;
+        drop_entry(victim, doomed);
+    }
+    return true;
+}
+
+// Moves a finished .part file into the index. Pinned entries go in even over
+// the cap. Only the index changes under lock; deletes, the rename and the
+// index write happen outside it, so the main thread never waits on the SD card.
+// The key is reserved in between, so a second download of it finishing at the
+// same time is dropped rather than renamed over this one.
+static bool commit(const char* key, const char* part, u32 size, bool pinned) {
+    char path[256]; entry_path(path, sizeof(path), key, "bin");
+    std::vector<std::string> doomed;
+    LightLock_Lock(&lock);
+    bool ok = true;
+    for (Committing& c : committing) if (c.key == key) { c.pinned = c.pinned || pinned; ok = false; } // it takes our pin
+    int old = ok ? find(key) : -1;
+    if (old >= 0) {
+        if (pinned && !entries[old].pinned) { entries[old].pinned = 1; dirty = true; generation++; }
+        pinned = entries[old].pinned;
+        if (entries[old].in_use) ok = false; // a reader still has the old file open: keep it
+        else drop_entry(old, doomed);
+    }
+    ok = ok && (make_room(size, doomed) || pinned);
+    bool reserved = ok;
+    if (reserved) { Committing c; c.key = key; c.pinned = pinned; committing.push_back(c); }
+    LightLock_Unlock(&lock);
+
+    for (const std::string& d : doomed) remove(d.c_str());
+    ok = ok && rename(part, path) == 0;
+    if (!ok) remove(part);
+
+    IndexSnapshot snap;
+    LightLock_Lock(&lock);
+    for (size_t i = 0; reserved && i < committing.size(); i++) {
+        if (committing[i].key != key) continue;
+        pinned = committing[i].pinned; committing.erase(committing.begin() + i); break;
+    }
+    if (ok) {
+        CacheEntry e; memset(&e, 0, sizeof(e));
+        strncpy(e.key, key, CACHE_KEY_LEN - 1);
+        e.size = size; e.last_used = ++use_clock; e.pinned = pinned;
+        entries.push_back(e); total_bytes += size; generation++; dirty = true;
+    }
+    bool save = dirty;
+    if (save) snapshot_index(snap);
+    LightLock_Unlock(&lock);
+    if (save) write_index(snap);
+    return ok;
+}
+
+static void load_index() {
+    entries.clear(); total_bytes = 0; use_clock = 0;
+    bool valid = false;
+    FILE* f = fopen(CACHE_INDEX, "rb");
+    if (f) {
+        IndexHeader h;
+        if (fread(&h, sizeof(h), 1, f) == 1 && h.magic == CACHE_MAGIC && h.version == CACHE_VERSION) {
+            entries.resize(h.count);
+            valid = h.count == 0 || fread(entries.data(), sizeof(CacheEntry), h.count, f) == h.count;
+            use_clock = h.clock;
+        }
+        fclose(f);
+    }
+    if (!valid) entries.clear();
+
+    // Drop entries whose file vanished, then reconcile the directory: stale
+    // .part files go, and orphaned .bin files are adopted if the index was lost.
+    for (size_t i = 0; i < entries.size(); ) {
+        char path[256]; struct stat st;
+        entries[i].key[CACHE_KEY_LEN - 1] = '\0'; entries[i].in_use = 0;
+        entry_path(path, sizeof(path), entries[i].key, "bin");
+        if (stat(path, &st) != 0 || (u32)st.st_size != entries[i].size) { remove(path); entries.erase(entries.begin() + i); dirty = true; continue; }
+        total_bytes += entries[i].size; i++;
+    }
+    DIR* dir = opendir(CACHE_DIR);
+    if (!dir) return;
+    while (struct dirent* de = readdir(dir)) {
+        char key[CACHE_KEY_LEN]; const char* dot = strrchr(de->d_name, '.');
+        if (!dot) continue;
+        char path[256]; snprintf(path, sizeof(path), "%s/%s", CACHE_DIR, de->d_name);
+        if (!strcmp(dot, ".part")) { remove(path); continue; }
+        if ((size_t)(dot - de->d_name) >= CACHE_KEY_LEN) continue;
+        memcpy(key, de->d_name, dot - de->d_name); key[dot - de->d_name] = '\0';
+        if (strcmp(dot, ".bin") || find(key) >= 0) continue;
+        struct stat st;
+        if (valid || stat(path, &st) != 0) { remove(path); continue; }
+        CacheEntry e; memset(&e, 0, sizeof(e));
+        strcpy(e.key, key); e.size = (u32)st.st_size;
+        entries.push_back(e); total_bytes += e.size; dirty = true;
+    }
+    closedir(dir);
+}
+
+// --- Background pinning ---
+
+static void pin_worker(void*) {
+    CURL* curl = curl_easy_init(); // kept across jobs so the connection stays open
+    while (pin_run) {
+        LightLock_Lock(&lock);
+        bool have = !pin_jobs.empty();
+        PinJob job; if (have) { job = pin_jobs.front(); pin_jobs.erase(pin_jobs.begin()); }
+        pin_busy = have;
+        LightLock_Unlock(&lock);
+        if (!have) { LightEvent_WaitTimeout(&pin_event, 500000000LL); continue; }
+
+        char part[256]; part_path(part, sizeof(part), job.key.c_str());
+        FILE* f = fopen(part, "wb");
+        if (!f) continue;
+        curl_easy_reset(curl); net_setup(curl, &pin_run);
+        curl_easy_setopt(curl, CURLOPT_URL, job.url.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, fwrite); curl_easy_setopt(curl, CURLOPT_WRITEDATA, f);
+        long code = 0;
+        CURLcode res = net_perform(curl, NET_PIN, &code);
+        u32 size = (u32)ftell(f); fclose(f);
+        if (res == CURLE_OK && code == 200) commit(job.key.c_str(), part, size, true);
+        else remove(part);
+    }
+    curl_easy_cleanup(curl);
+    pin_busy = false;
+}
+
+void cache_init() {
+    LightLock_Init(&lock); LightLock_Init(&index_lock);
+    LightEvent_Init(&pin_event, RESET_ONESHOT);
+    mkdir(CACHE_DIR, 0777);
+    load_index();
+    if (dirty) { IndexSnapshot snap; snapshot_index(snap); write_index(snap); }
+
+    s32 prio = 0x30; svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+    pin_run = true;
+    pin_thread = threadCreate(pin_worker, NULL, 32 * 1024, prio + 1, -2, false);
+}
+
+void cache_exit() {
+    if (pin_thread) { pin_run = false; LightEvent_Signal(&pin_event); threadJoin(pin_thread, U64_MAX); threadFree(pin_thread); pin_thread = NULL; }
+    IndexSnapshot snap;
+    LightLock_Lock(&lock);
+    bool save = dirty;
+    if (save) snapshot_index(snap);
+    LightLock_Unlock(&lock);
+    if (save) write_index(snap);
+}
+
+void cache_make_key(char* out, const char* item_id, const char* params) {
+    u32 h = 2166136261u; // FNV-1a
+    for (const char* p = params; *p; p++) { h ^= (u8)*p; h *= 16777619u; }
+    snprintf(out, CACHE_KEY_LEN, "%.38s-%08lx", item_id, (unsigned long)h);
+}
+
+bool cache_has(const char* key) {
+    LightLock_Lock(&lock);
+    bool hit = find(key) >= 0;
+    LightLock_Unlock(&lock);
+    return hit;
+}
+
+bool cache_lookup(const char* key, char* path, size_t path_len) {
+    LightLock_Lock(&lock);
+    int i = find(key);
+    if (i >= 0) {
+        entries[i].last_used = ++use_clock; entries[i].in_use++;
+        entry_path(path, path_len, key, "bin");
+        dirty = true;
+    }
+    LightLock_Unlock(&lock);
+    return i >= 0;
+}
+
+void cache_release(const char* key) {
+    LightLock_Lock(&lock);
+    int i = find(key);
+    if (i >= 0 && entries[i].in_use) entries[i].in_use--;
+    LightLock_Unlock(&lock);
+}
+
+CacheState cache_item_state(const char* item_id) {
+    CacheState s = CACHE_NONE;
+    LightLock_Lock(&lock);
+    for (const CacheEntry& e : entries) if (is_variant(e, item_id)) { s = e.pinned ? CACHE_PINNED : CACHE_STORED; if (e.pinned) break; }
+    LightLock_Unlock(&lock);
+    return s;
+}
+
+void cache_pin(const char* item_id, const char* key, const char* url) {
+    IndexSnapshot snap;
+    LightLock_Lock(&lock);
+    bool found = false;
+    for (CacheEntry& e : entries) if (is_variant(e, item_id)) { e.pinned = 1; found = true; generation++; }
+    if (found) snapshot_index(snap);
+    else {
+        bool queued = false;
+        for (const PinJob& j : pin_jobs) if (j.key == key) queued = true;
+        if (!queued) { PinJob j; j.key = key; j.url = url; pin_jobs.push_back(j); }
+    }
+    LightLock_Unlock(&lock);
+    if (found) write_index(snap);
+    LightEvent_Signal(&pin_event);
+}
+
+void cache_unpin(const char* item_id) {
+    IndexSnapshot snap;
+    LightLock_Lock(&lock);
+    for (CacheEntry& e : entries) if (is_variant(e, item_id)) { e.pinned = 0; generation++; }
+    size_t n = strlen(item_id);
+    for (size_t i = 0; i < pin_jobs.size(); ) {
+        if (!strncmp(pin_jobs[i].key.c_str(), item_id, n)) pin_jobs.erase(pin_jobs.begin() + i); else i++;
+    }
+    snapshot_index(snap);
+    LightLock_Unlock(&lock);
+    write_index(snap);
+}
+
+u32 cache_generation() { return generation; }
+
+int cache_pending_pins() {
+    LightLock_Lock(&lock);
+    int n = (int)pin_jobs.size() + (pin_busy ? 1 : 0);
+    LightLock_Unlock(&lock);
+    return n;
+}
+
+// --- Stream tee ---
+
+static void writer_thread(void* arg) {
+    CacheWriter* w = (CacheWriter*)arg;
+    u8* buf = (u8*)malloc(COPY_CHUNK);
+    for (;;) {
+        bool run = w->run;
+        size_t n = buf ? w->ring.read(buf, COPY_CHUNK) : 0;
+        if (n) {
+            if (!w->failed && fwrite(buf, 1, n, w->f) != n) w->failed = true;
+            w->bytes += n;
+        } else if (!run) break;
+        else LightEvent_WaitTimeout(&w->event, 50000000);
+    }
+    free(buf);
+}
+
+bool cache_writer_begin(CacheWriter* w, const char* key) {
+    if (!cache_config.max_mb) return false;
+    if (!w->ring.data && !w->ring.init(WRITER_RING)) return false;
+    w->ring.reset();
+    part_path(w->part, sizeof(w->part), key);
+    w->f = fopen(w->part, "wb");
+    if (!w->f) return false;
+    strncpy(w->key, key, CACHE_KEY_LEN - 1); w->key[CACHE_KEY_LEN - 1] = '\0';
+    w->bytes = 0; w->failed = false; w->run = true;
+    LightEvent_Init(&w->event, RESET_ONESHOT);
+    s32 prio = 0x30; svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+    w->thread = threadCreate(writer_thread, w, 16 * 1024, prio + 1, -2, false);
+    if (!w->thread) { fclose(w->f); w->f = NULL; remove(w->part); return false; }
+    return true;
+}
+
+void cache_writer_push(CacheWriter* w, const void* data, size_t len) {
+    if (!w->thread || w->failed) return;
+    if (w->ring.write(data, len) < len) w->failed = true; // SD fell behind; drop the entry rather than stall playback
+    LightEvent_Signal(&w->event);
+}
+
+void cache_writer_finish(CacheWriter* w, bool complete) {
+    if (!w->thread) return;
+    w->run = false; LightEvent_Signal(&w->event);
+    threadJoin(w->thread, U64_MAX); threadFree(w->thread); w->thread = NULL;
+    fclose(w->f); w->f = NULL;
+    if (complete && !w->failed) commit(w->key, w->part, w->bytes, false);
+    else remove(w->part);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <3ds.h>
+#include <stdio.h>
+#include "pcm_ring.h"
+
+// --- On-SD audio cache ---
+// Finished stream bodies are kept under CACHE_DIR, keyed by item Id plus a
+// hash of the transcode parameters, with an LRU index that survives
+// restarts. Pinned entries are never evicted and can be fetched in the
+// background for offline use.
+#define CACHE_DIR       "sdmc:/3ds/JellyCTR/cache"
+#define CACHE_KEY_LEN   48
+
+struct CacheConfig {
+    u32 max_mb; // size cap; 0 stops new entries from being written
+};
+
+extern CacheConfig cache_config;
+
+enum CacheState { CACHE_NONE, CACHE_STORED, CACHE_PINNED };
+
+void cache_init();
+void cache_exit();
+
+void cache_make_key(char* out, const char* item_id, const char* params);
+bool cache_has(const char* key);
+bool cache_lookup(const char* key, char* path, size_t path_len); // hit: marks it in use
+void cache_release(const char* key);
+CacheState cache_item_state(const char* item_id); // best of all variants of an item
+
+// Pins every cached variant of the item, or queues a download of url as key
+void cache_pin(const char* item_id, const char* key, const char* url);
+void cache_unpin(const char* item_id);
+int cache_pending_pins();
+u32 cache_generation(); // changes whenever a cache_item_state() result may have
+
+// Tees a network stream into the cache from a low-priority thread. push()
+// never blocks: if the SD card falls behind the entry is dropped instead.
+struct CacheWriter {
+    PcmRing ring;
+    FILE* f = NULL;
+    Thread thread = NULL;
+    char key[CACHE_KEY_LEN];
+    char part[256]; // this writer's own .part file
+    u32 bytes = 0;
+    volatile bool run = false, failed = false;
+    LightEvent event;
+};
+
+bool cache_writer_begin(CacheWriter* w, const char* key);
+void cache_writer_push(CacheWriter* w, const void* data, size_t len);
+void cache_writer_finish(CacheWriter* w, bool complete);
@@ -0,0 +1,148 @@
+#include "codec.h"
+#include <string.h>
+#include <opus/opusfile.h>
+#include <mpg123.h>
+#include <FLAC/stream_decoder.h>
+
+const char* const codec_names[] = { "pcm", "opus", "mp3", "flac", NULL };
+
+const char* const codec_queries[] = {
+    "audioCodec=pcm_s16le&container=raw",
+    "audioCodec=opus&container=ogg",
+    "audioCodec=mp3&container=mp3",
+    "audioCodec=flac&container=flac&audioBitDepth=16",
+};
+
+const uint32_t codec_kbps[] = { 1536, 192, 320, 0 };
+
+#define OUT_FRAMES 2048
+
+struct DecodeCtx {
+    const CodecIo* io;
+    bool aborted;
+    int16_t out[OUT_FRAMES * 2];
+};
+
+static bool emit(DecodeCtx* ctx, const int16_t* frames, size_t count) {
+    if (!ctx->io->write(ctx->io->user, frames, count)) ctx->aborted = true;
+    return !ctx->aborted;
+}
+
+// --- Raw s16le: carry split frames across reads ---
+static bool decode_pcm(DecodeCtx* ctx) {
+    uint8_t* buf = (uint8_t*)ctx->out; size_t have = 0;
+    for (;;) {
+        size_t n = ctx->io->read(ctx->io->user, buf + have, sizeof(ctx->out) - have);
+        if (!n) break;
+        have += n;
+        size_t whole = have / 4;
+        if (whole && !emit(ctx, ctx->out, whole)) return false;
+        memmove(buf, buf + whole * 4, have - whole * 4); have -= whole * 4;
+    }
+    return true;
+}
+
+// --- Opus in Ogg, read as a non-seekable stream ---
+static int opus_read(void* stream, unsigned char* ptr, int nbytes) {
+    DecodeCtx* ctx = (DecodeCtx*)stream;
+    return (int)ctx->io->read(ctx->io->user, ptr, (size_t)nbytes);
+}
+
+static bool decode_opus(DecodeCtx* ctx) {
+    OpusFileCallbacks cb = { opus_read, NULL, NULL, NULL };
+    int err = 0;
+    OggOpusFile* of = op_open_callbacks(ctx, &cb, NULL, 0, &err);
+    if (!of) return false;
+    bool ok = true;
+    for (;;) {
+        int n = op_read_stereo(of, ctx->out, OUT_FRAMES * 2);
+        if (n == OP_HOLE) continue;
+        if (n < 0) { ok = false; break; }
+        if (n == 0) break;
+        if (!emit(ctx, ctx->out, n)) { ok = false; break; }
+    }
+    op_free(of);
+    return ok;
+}
+
+// --- MP3 through mpg123's feed API; NtoM resampling covers non-48k sources ---
+static bool decode_mp3(DecodeCtx* ctx) {
+    mpg123_init();
+    int err = 0;
+    mpg123_handle* mh = mpg123_new(NULL, &err);
+    if (!mh) return false;
+    mpg123_param(mh, MPG123_FLAGS, MPG123_FORCE_STEREO | MPG123_QUIET, 0);
+    mpg123_format_none(mh);
+    mpg123_format(mh, 48000, MPG123_STEREO, MPG123_ENC_SIGNED_16);
+    if (mpg123_open_feed(mh) != MPG123_OK) { mpg123_delete(mh); return false; }
+
+    unsigned char in[8192];
+    bool ok = true;
+    for (;;) {
+        size_t n = ctx->io->read(ctx->io->user, in, sizeof(in));
+        if (!n) break;
+        if (mpg123_feed(mh, in, n) != MPG123_OK) { ok = false; break; }
+        int r; size_t done;
+        do {
+            r = mpg123_read(mh, (unsigned char*)ctx->out, sizeof(ctx->out), &done);
+            if (done && !emit(ctx, ctx->out, done / 4)) { ok = false; break; }
+        } while (r == MPG123_OK || r == MPG123_NEW_FORMAT);
+        if (!ok) break;
+        if (r != MPG123_NEED_MORE) { ok = false; break; }
+    }
+    mpg123_delete(mh);
+    return ok;
+}
+
+// --- FLAC: planar int32 at any bit depth -> interleaved s16 ---
+static FLAC__StreamDecoderReadStatus flac_read(const FLAC__StreamDecoder*, FLAC__byte buffer[], size_t* bytes, void* client) {
+    DecodeCtx* ctx = (DecodeCtx*)client;
+    *bytes = ctx->io->read(ctx->io->user, buffer, *bytes);
+    return *bytes ? FLAC__STREAM_DECODER_READ_STATUS_CONTINUE : FLAC__STREAM_DECODER_READ_STATUS_END_OF_STREAM;
+}
+
+static FLAC__StreamDecoderWriteStatus flac_write(const FLAC__StreamDecoder*, const FLAC__Frame* frame, const FLAC__int32* const buffer[], void* client) {
+    DecodeCtx* ctx = (DecodeCtx*)client;
+    const FLAC__int32* l = buffer[0];
+    const FLAC__int32* r = buffer[frame->header.channels > 1 ? 1 : 0];
+    int bps = (int)frame->header.bits_per_sample;
+    for (unsigned pos = 0; pos < frame->header.blocksize; ) {
+        unsigned n = frame->header.blocksize - pos; if (n > OUT_FRAMES) n = OUT_FRAMES;
+        for (unsigned i = 0; i < n; i++) {
+            FLAC__int32 a = l[pos + i], b = r[pos + i];
+            if (bps > 16) { a >>= bps - 16; b >>= bps - 16; } else if (bps < 16) { a <<= 16 - bps; b <<= 16 - bps; }
+            ctx->out[i * 2] = (int16_t)a; ctx->out[i * 2 + 1] = (int16_t)b;
+        }
+        if (!emit(ctx, ctx->out, n)) return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+        pos += n;
+    }
+    return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+}
+
+static void flac_error(const FLAC__StreamDecoder*, FLAC__StreamDecoderErrorStatus, void*) {}
+
+static bool decode_flac(DecodeCtx* ctx) {
+    FLAC__StreamDecoder* d = FLAC__stream_decoder_new();
+    if (!d) return false;
+    bool ok = FLAC__stream_decoder_init_stream(d, flac_read, NULL, NULL, NULL, NULL, flac_write, NULL, flac_error, ctx) == FLAC__STREAM_DECODER_INIT_STATUS_OK
+        && FLAC__stream_decoder_process_until_end_of_stream(d);
+    FLAC__stream_decoder_finish(d);
+    FLAC__stream_decoder_delete(d);
+    return ok && !ctx->aborted;
+}
+
+bool codec_decode(Codec codec, const CodecIo& io) {
+    // ~8 KB of scratch; keep it off the decoder thread's stack
+    DecodeCtx* ctx = new DecodeCtx;
+    ctx->io = &io; ctx->aborted = false;
+    bool ok = false;
+    switch (codec) {
+        case CODEC_PCM:  ok = decode_pcm(ctx); break;
+        case CODEC_OPUS: ok = decode_opus(ctx); break;
+        case CODEC_MP3:  ok = decode_mp3(ctx); break;
+        case CODEC_FLAC: ok = decode_flac(ctx); break;
+        default: break;
+    }
+    delete ctx;
+    return ok;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// --- Compressed stream decoders ---
+// Platform-free so the same code runs in tools/decode_bench on a PC.
+enum Codec { CODEC_PCM, CODEC_OPUS, CODEC_MP3, CODEC_FLAC, CODEC_COUNT };
+
+// Indexed by Codec, NULL-terminated. Also the spelling used in config.txt.
+extern const char* const codec_names[];
+// Query fragment for /Audio/{id}/stream asking Jellyfin for that codec,
+// and the audioBitRate to go with it by default (0: none, it is lossless)
+extern const char* const codec_queries[];
+extern const uint32_t codec_kbps[];
+
+// read() blocks until it has input and returns 0 at end of stream.
+// write() gets interleaved 48 kHz stereo s16 frames and returns false to abort.
+struct CodecIo {
+    size_t (*read)(void* user, void* dst, size_t len);
+    bool (*write)(void* user, const int16_t* frames, size_t count);
+    void* user;
+};
+
+// Decodes until input ends (true) or on error/abort (false).
+bool codec_decode(Codec codec, const CodecIo& io);
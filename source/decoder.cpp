@@ -0,0 +1,89 @@
+#include "decoder.h"
+#include "audio.h"
+
+#define DECODER_IN_SIZE (256 * 1024)
+
+// Called on entering a wait: the time since the last one was spent decoding
+static void account_busy(Decoder* d, u64 now) {
+    d->busy_ticks += now - d->mark_tick;
+    d->busy_us.store((u32)(d->busy_ticks / (SYSCLOCK_ARM11 / 1000000)), std::memory_order_relaxed);
+}
+
+static size_t ring_read(void* user, void* dst, size_t len) {
+    Decoder* d = (Decoder*)user;
+    account_busy(d, svcGetSystemTick());
+    size_t n = 0;
+    while (d->run) {
+        bool eof = d->in.eof.load();
+        if ((n = d->in.read(dst, len))) { LightEvent_Signal(&d->space_event); break; }
+        if (eof) break;
+        LightEvent_WaitTimeout(&d->data_event, 20000000);
+    }
+    d->mark_tick = svcGetSystemTick();
+    return n;
+}
+
+static bool pcm_write(void* user, const int16_t* frames, size_t count) {
+    Decoder* d = (Decoder*)user;
+    if (d->skip) {
+        size_t n = count < d->skip ? count : (size_t)d->skip;
+        d->skip -= n; frames += n * 2; count -= n;
+        if (!count) return true;
+    }
+    account_busy(d, svcGetSystemTick());
+    bool ok = audio_write(d->out, frames, count * FRAME_BYTES, &d->run) == count * FRAME_BYTES;
+    d->frames.store(d->frames.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    d->mark_tick = svcGetSystemTick();
+    return ok;
+}
+
+static void decoder_thread(void* arg) {
+    Decoder* d = (Decoder*)arg;
+    CodecIo io = { ring_read, pcm_write, d };
+    d->mark_tick = svcGetSystemTick();
+    codec_decode(d->codec, io);
+    d->done = true; // unblocks decoder_write() if we bailed out early
+    if (d->run) audio_end_stream(d->out);
+}
+
+bool decoder_start(Decoder* d, Codec codec, PcmRing* out, u64 skip_frames) {
+    decoder_stop(d);
+    if (!d->in.data && !d->in.init(DECODER_IN_SIZE)) return false;
+    d->in.reset();
+    LightEvent_Init(&d->data_event, RESET_ONESHOT);
+    LightEvent_Init(&d->space_event, RESET_ONESHOT);
+    d->out = out; d->codec = codec; d->skip = skip_frames; d->run = true; d->done = false;
+
+    // Decoding is the heaviest thing we do; the N3DS has a spare core for it
+    bool n3ds = false; APT_CheckNew3DS(&n3ds);
+    s32 prio = 0x30; svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+    d->thread = threadCreate(decoder_thread, d, 32 * 1024, prio - 1, n3ds ? 2 : -2, false);
+    if (!d->thread) { d->run = false; return false; }
+    return true;
+}
+
+size_t decoder_write(Decoder* d, const void* data, size_t len, volatile bool* run) {
+    const u8* p = (const u8*)data; size_t done = 0;
+    while (done < len && *run && !d->done) {
+        size_t n = d->in.write(p + done, len - done);
+        if (n) { done += n; LightEvent_Signal(&d->data_event); }
+        else LightEvent_WaitTimeout(&d->space_event, 20000000);
+    }
+    return done;
+}
+
+void decoder_end(Decoder* d) { d->in.eof.store(true); LightEvent_Signal(&d->data_event); }
+
+void decoder_stop(Decoder* d) {
+    if (!d->thread) return;
+    d->run = false;
+    LightEvent_Signal(&d->data_event); LightEvent_Signal(&d->space_event);
+    threadJoin(d->thread, U64_MAX); threadFree(d->thread); d->thread = NULL;
+}
+
+void decoder_free(Decoder* d) { decoder_stop(d); d->in.release(); }
+
+DecoderStats decoder_get_stats(const Decoder* d) {
+    DecoderStats s = { d->busy_us.load(std::memory_order_relaxed), d->frames.load(std::memory_order_relaxed) };
+    return s;
+}
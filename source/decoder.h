@@ -0,0 +1,34 @@
+#pragma once
+#include <3ds.h>
+#include "codec.h"
+#include "pcm_ring.h"
+
+// --- Decode stage ---
+// Sits between the network thread and a PCM ring for compressed codecs:
+// the network side pushes encoded bytes with decoder_write(), a dedicated
+// thread runs codec_decode() and hands PCM to audio_write().
+
+// Running totals over every stream a decoder has run, wrapping: take differences
+struct DecoderStats {
+    u32 busy_us; // time spent decoding, excluding waits on either ring
+    u32 frames;  // PCM frames produced
+};
+
+struct Decoder {
+    PcmRing in;   // encoded bytes, same SPSC ring the PCM side uses
+    PcmRing* out = NULL;
+    Codec codec = CODEC_PCM;
+    Thread thread = NULL;
+    volatile bool run = false, done = false;
+    LightEvent data_event, space_event;
+    u64 mark_tick = 0, busy_ticks = 0; // decoder thread: when it last stopped waiting, and time spent decoding
+    u64 skip = 0; // PCM frames still to drop, for a seek into a cached file
+    std::atomic<u32> busy_us{0}, frames{0};
+};
+
+bool decoder_start(Decoder* d, Codec codec, PcmRing* out, u64 skip_frames = 0);
+size_t decoder_write(Decoder* d, const void* data, size_t len, volatile bool* run);
+void decoder_end(Decoder* d);  // input complete; the decoder drains and ends the PCM ring
+void decoder_stop(Decoder* d);
+void decoder_free(Decoder* d);
+DecoderStats decoder_get_stats(const Decoder* d);
@@ -0,0 +1,313 @@
+#include "library.h"
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#define LIBRARY_MAGIC       0x424C434A // "JCLB"
+#define LIBRARY_VERSION     2
+#define LIBRARY_TRACK_LISTS 64
+#define LIBRARY_ALBUMS_Q    "/Items?IncludeItemTypes=MusicAlbum&Recursive=true&SortBy=SortName&Fields=DateLastSaved"
+#define LIBRARY_TRACKS_Q    "/Items?IncludeItemTypes=Audio&Recursive=true&Fields=DateLastSaved"
+
+// Only what the list and player show; images and user data are left off
+#define LIBRARY_PROJECTION "EnableImages=false&EnableUserData=false&EnableTotalRecordCount=true"
+
+static const char* get_string(json_object* o, const char* key) {
+    json_object* v;
+    return json_object_object_get_ex(o, key, &v) ? json_object_get_string(v) : NULL;
+}
+
+static void read_items(LibraryPage* p, json_object* root) {
+    json_object *items, *total;
+    if (json_object_object_get_ex(root, "TotalRecordCount", &total)) p->total = json_object_get_int(total);
+    if (!json_object_object_get_ex(root, "Items", &items)) return;
+    size_t n = json_object_array_length(items);
+    for (size_t i = 0; i < n; i++) {
+        json_object *it = json_object_array_get_idx(items, i), *dur;
+        ItemId id, parent = {}; const char* v;
+        if (!(v = get_string(it, "Id")) || !item_id_parse(&id, v)) continue;
+        if ((v = get_string(it, "AlbumId")) && !item_id_parse(&parent, v)) parent = ItemId();
+        const char* album = get_string(it, "Album");
+        u32 ms = json_object_object_get_ex(it, "RunTimeTicks", &dur) ? (u32)(json_object_get_int64(dur) / 10000) : 0;
+        // ISO 8601 in one format, so plain string order is time order
+        if ((v = get_string(it, "DateLastSaved")) && strcmp(v, p->max_saved) > 0) { strncpy(p->max_saved, v, sizeof(p->max_saved) - 1); }
+        p->items.push(id, get_string(it, "Name"), album ? album : "Unknown Album", parent, ms);
+    }
+}
+
+// Feeds the tokener as bytes arrive; the page is converted once it closes
+static bool page_sink(const void* data, size_t len, void* user) {
+    LibraryPage* p = (LibraryPage*)user;
+    if (!p->tok) return p->ok; // trailing bytes after a complete page are fine
+    json_object* root = json_tokener_parse_ex(p->tok, (const char*)data, (int)len);
+    enum json_tokener_error err = json_tokener_get_error(p->tok);
+    if (err == json_tokener_continue) return true;
+    if (root) { read_items(p, root); json_object_put(root); p->ok = true; }
+    json_tokener_free(p->tok); p->tok = NULL;
+    return err == json_tokener_success;
+}
+
+u32 library_fetch(const char* query_url, int start, int limit, int tag, NetDone done) {
+    char url[1024];
+    snprintf(url, sizeof(url), "%s%cStartIndex=%d&Limit=%d&" LIBRARY_PROJECTION, query_url, strchr(query_url, '?') ? '&' : '?', start, limit);
+    LibraryPage* p = new LibraryPage;
+    p->items.arena = &p->strings;
+    p->tok = json_tokener_new(); p->start = start; p->total = -1; p->tag = tag; p->ok = false;
+    memset(p->max_saved, 0, sizeof(p->max_saved));
+    return net_submit_sink(url, page_sink, done, p);
+}
+
+void library_page_free(LibraryPage* p) {
+    if (p->tok) json_tokener_free(p->tok);
+    delete p;
+}
+
+// --- Snapshot ---
+// Header, server and watermark strings, the arena's bytes, then each list as
+// raw columns: albums first, then (album id, tracks) per track list.
+struct TrackList { ItemId album; ItemList tracks; };
+struct SnapshotHeader { u32 magic, version, albums, track_lists, arena_bytes; };
+
+StringArena library_strings;
+ItemList library_albums(&library_strings);
+static std::vector<TrackList> track_lists; // least recently opened first
+static std::string server, watermark;      // watermark: newest DateLastSaved synced
+static bool dirty = false, changed = false;
+static std::vector<ItemList*> kept_lists;  // the caller's lists on library_strings
+static size_t compacted_bytes = 0;         // arena size after the last compaction
+
+// Background sync: ALBUMS pulls albums saved since the watermark and merges
+// them in place. COUNT then compares the server's album total with ours; a
+// mismatch means something was removed and forces FULL. So does any album
+// ALBUMS added, since a removal can hide behind it and leave the totals
+// equal. Otherwise TRACKS drops the cached track lists of albums whose
+// tracks changed.
+enum SyncStage { SYNC_IDLE, SYNC_ALBUMS, SYNC_COUNT, SYNC_TRACKS, SYNC_FULL };
+
+static SyncStage stage = SYNC_IDLE;
+static u32 sync_request = 0;
+static ItemList sync_albums(&library_strings); // FULL builds here unless there is nothing to show yet
+static bool sync_direct = false;
+static u32 sync_added = 0; // albums ALBUMS inserted rather than updated
+static std::string sync_watermark;
+
+static void on_sync_page(const NetResult* r);
+
+static void put_str(FILE* f, const std::string& s) {
+    u16 n = s.size() > 0xFFFF ? 0xFFFF : (u16)s.size();
+    fwrite(&n, sizeof(n), 1, f); fwrite(s.data(), 1, n, f);
+}
+
+static bool get_str(FILE* f, std::string& s) {
+    u16 n;
+    if (fread(&n, sizeof(n), 1, f) != 1) return false;
+    s.resize(n);
+    return !n || fread(&s[0], 1, n, f) == n;
+}
+
+static u64 file_left(FILE* f) {
+    long at = ftell(f);
+    if (at < 0 || fseek(f, 0, SEEK_END)) return 0;
+    long end = ftell(f);
+    fseek(f, at, SEEK_SET);
+    return end > at ? (u64)(end - at) : 0;
+}
+
+template <typename T> static void put_column(FILE* f, const std::vector<T>& v) { if (!v.empty()) fwrite(v.data(), sizeof(T), v.size(), f); }
+// Counts come from the file, so one that runs past its end is refused before allocating
+template <typename T> static bool get_column(FILE* f, std::vector<T>& v, u32 n) {
+    if ((u64)n * sizeof(T) > file_left(f)) return false;
+    v.resize(n); return !n || fread(v.data(), sizeof(T), n, f) == n;
+}
+
+static void put_items(FILE* f, const ItemList& items) {
+    u32 n = items.size(); fwrite(&n, sizeof(n), 1, f);
+    put_column(f, items.ids); put_column(f, items.parents);
+    put_column(f, items.names); put_column(f, items.albums); put_column(f, items.duration_ms);
+}
+
+static bool get_items(FILE* f, ItemList& items) {
+    u32 n;
+    if (fread(&n, sizeof(n), 1, f) != 1 || n > (1 << 20)) return false;
+    if (!get_column(f, items.ids, n) || !get_column(f, items.parents, n) || !get_column(f, items.names, n) ||
+        !get_column(f, items.albums, n) || !get_column(f, items.duration_ms, n)) return false;
+    size_t limit = items.arena->data.size();
+    for (u32 i = 0; i < n; i++) if (items.names[i] >= limit || items.albums[i] >= limit) return false;
+    return true;
+}
+
+static void compact_strings() {
+    std::vector<ItemList*> lists(kept_lists);
+    lists.push_back(&library_albums); lists.push_back(&sync_albums);
+    for (TrackList& tl : track_lists) lists.push_back(&tl.tracks);
+    arena_compact(library_strings, lists.data(), lists.size());
+    compacted_bytes = library_strings.data.size();
+}
+
+void library_keep(ItemList* list) { kept_lists.push_back(list); }
+
+void library_trim() {
+    if (library_strings.data.size() > compacted_bytes * 2 + 64 * 1024) compact_strings();
+}
+
+static void clear_library() {
+    library_albums.clear(); sync_albums.clear(); track_lists.clear(); watermark.clear();
+    library_strings.clear();
+}
+
+// Every ItemList on library_strings must be rebuilt after this
+bool library_load(const char* server_url) {
+    if (sync_request) { net_cancel(sync_request); sync_request = 0; }
+    stage = SYNC_IDLE;
+    clear_library(); dirty = false; changed = true;
+    server = server_url;
+    FILE* f = fopen(LIBRARY_SNAPSHOT, "rb");
+    if (!f) return false;
+    SnapshotHeader h; std::string snap_server;
+    bool ok = fread(&h, sizeof(h), 1, f) == 1 && h.magic == LIBRARY_MAGIC && h.version == LIBRARY_VERSION &&
+              get_str(f, snap_server) && snap_server == server && get_str(f, watermark) &&
+              get_column(f, library_strings.data, h.arena_bytes) && library_strings.rebuild() && get_items(f, library_albums);
+    for (u32 i = 0; ok && i < h.track_lists; i++) {
+        TrackList tl; tl.tracks.arena = &library_strings;
+        ok = fread(&tl.album, sizeof(tl.album), 1, f) == 1 && get_items(f, tl.tracks);
+        if (ok) track_lists.push_back(tl);
+    }
+    fclose(f);
+    if (!ok) clear_library();
+    compacted_bytes = library_strings.data.size();
+    return ok && !library_albums.empty();
+}
+
+void library_save() {
+    if (!dirty) return;
+    compact_strings();
+    FILE* f = fopen(LIBRARY_SNAPSHOT ".tmp", "wb");
+    if (!f) return;
+    SnapshotHeader h = { LIBRARY_MAGIC, LIBRARY_VERSION, (u32)library_albums.size(), (u32)track_lists.size(), (u32)library_strings.data.size() };
+    fwrite(&h, sizeof(h), 1, f);
+    put_str(f, server); put_str(f, watermark);
+    put_column(f, library_strings.data);
+    put_items(f, library_albums);
+    for (const TrackList& tl : track_lists) { fwrite(&tl.album, sizeof(tl.album), 1, f); put_items(f, tl.tracks); }
+    bool ok = !ferror(f);
+    fclose(f);
+    if (ok) { remove(LIBRARY_SNAPSHOT); ok = rename(LIBRARY_SNAPSHOT ".tmp", LIBRARY_SNAPSHOT) == 0; }
+    if (ok) dirty = false;
+}
+
+bool library_take_changed() { bool c = changed; changed = false; return c; }
+
+static int find_track_list(const ItemId& album) {
+    for (size_t i = 0; i < track_lists.size(); i++) if (track_lists[i].album == album) return (int)i;
+    return -1;
+}
+
+const ItemList* library_tracks(const ItemId& album) {
+    int i = find_track_list(album);
+    if (i < 0) return NULL;
+    if (i != (int)track_lists.size() - 1) { // move to the recent end
+        TrackList tl = track_lists[i];
+        track_lists.erase(track_lists.begin() + i); track_lists.push_back(tl);
+        dirty = true;
+    }
+    return &track_lists.back().tracks;
+}
+
+void library_store_tracks(const ItemId& album, const ItemList& tracks) {
+    int i = find_track_list(album);
+    if (i >= 0) track_lists.erase(track_lists.begin() + i);
+    TrackList tl; tl.album = album; tl.tracks.arena = &library_strings; tl.tracks.append(tracks);
+    track_lists.push_back(tl);
+    if (track_lists.size() > LIBRARY_TRACK_LISTS) track_lists.erase(track_lists.begin());
+    dirty = true;
+}
+
+static void drop_track_list(const ItemId& album) {
+    int i = find_track_list(album);
+    if (i >= 0) { track_lists.erase(track_lists.begin() + i); dirty = true; }
+}
+
+// --- Background sync ---
+static void sync_fetch(int start, int limit) {
+    std::string q = server + (stage == SYNC_TRACKS ? LIBRARY_TRACKS_Q : LIBRARY_ALBUMS_Q);
+    if ((stage == SYNC_ALBUMS || stage == SYNC_TRACKS) && !watermark.empty()) q += "&MinDateLastSaved=" + watermark;
+    sync_request = library_fetch(q.c_str(), start, limit, stage, on_sync_page);
+}
+
+static void sync_begin(SyncStage s) {
+    stage = s;
+    if (s == SYNC_FULL) { sync_albums.clear(); sync_direct = library_albums.empty(); sync_watermark.clear(); }
+    if (s == SYNC_IDLE) {
+        watermark = sync_watermark; dirty = true;
+        library_save();
+        return;
+    }
+    sync_fetch(0, s == SYNC_COUNT ? 0 : LIBRARY_PAGE);
+}
+
+static void merge_album(const ItemList& src, size_t i) {
+    drop_track_list(src.ids[i]);
+    int have = library_albums.find(src.ids[i]);
+    if (have >= 0) { library_albums.set(have, src, i); return; }
+    sync_added++;
+    size_t at = 0; // new album: approximate the server order by name
+    while (at < library_albums.size() && strcasecmp(library_albums.name(at), src.name(i)) <= 0) at++;
+    library_albums.insert(at, src, i);
+}
+
+static void on_sync_page(const NetResult* r) {
+    LibraryPage* p = (LibraryPage*)r->user;
+    if (r->id != sync_request) { library_page_free(p); return; } // superseded by library_load()
+    sync_request = 0;
+    if (r->cancelled || !p->ok || r->status >= 400) {
+        stage = SYNC_IDLE; // give up until the next library_sync()
+        library_page_free(p);
+        return;
+    }
+    if (strcmp(p->max_saved, sync_watermark.c_str()) > 0) sync_watermark = p->max_saved;
+    switch (stage) {
+    case SYNC_COUNT: {
+        bool same = p->total == (int)library_albums.size() && !sync_added;
+        library_page_free(p);
+        sync_begin(same ? SYNC_TRACKS : SYNC_FULL);
+        return;
+    }
+    case SYNC_FULL:
+        (sync_direct ? library_albums : sync_albums).append(p->items);
+        if (sync_direct) changed = true;
+        break;
+    case SYNC_ALBUMS:
+        for (size_t i = 0; i < p->items.size(); i++) merge_album(p->items, i);
+        if (!p->items.empty()) changed = dirty = true;
+        break;
+    case SYNC_TRACKS:
+        for (size_t i = 0; i < p->items.size(); i++) drop_track_list(p->items.parents[i]);
+        break;
+    default: break;
+    }
+    // Items with unparseable Ids are dropped by the parser, so page by what was asked for
+    int next = p->start + LIBRARY_PAGE;
+    bool more = next < p->total;
+    library_page_free(p);
+    if (more) { sync_fetch(next, LIBRARY_PAGE); return; }
+
+    if (stage == SYNC_FULL) {
+        if (!sync_direct) { std::swap(library_albums, sync_albums); sync_albums.clear(); changed = true; }
+        for (size_t i = 0; i < track_lists.size(); ) { // forget albums that are gone
+            if (library_albums.find(track_lists[i].album) >= 0) i++;
+            else track_lists.erase(track_lists.begin() + i);
+        }
+        sync_begin(SYNC_IDLE);
+    } else if (stage == SYNC_ALBUMS) sync_begin(SYNC_COUNT);
+    else sync_begin(SYNC_IDLE);
+}
+
+void library_sync() {
+    if (stage != SYNC_IDLE || server.empty()) return;
+    sync_watermark = watermark; sync_added = 0;
+    sync_begin(watermark.empty() || library_albums.empty() ? SYNC_FULL : SYNC_ALBUMS);
+}
+
+bool library_syncing() { return stage != SYNC_IDLE; }
+bool library_partial() { return stage == SYNC_FULL && sync_direct; }
+std::string library_albums_query() { return server + LIBRARY_ALBUMS_Q; }
@@ -0,0 +1,49 @@
+#pragma once
+#include <3ds.h>
+#include <json-c/json.h>
+#include <string>
+#include <vector>
+#include "net.h"
+#include "store.h"
+
+// --- Library browsing ---
+// Item lists are fetched LIBRARY_PAGE at a time. Each page is parsed on the
+// net worker as it downloads, so the main loop only appends finished items.
+// Albums and recently opened track lists are kept in a snapshot on the SD
+// card, refreshed in the background with DateLastSaved delta queries.
+#define LIBRARY_PAGE     100
+#define LIBRARY_SNAPSHOT "sdmc:/3ds/JellyCTR/library.bin"
+
+struct LibraryPage {
+    json_tokener* tok;
+    StringArena strings; // the page is parsed off the main thread, so it interns locally
+    ItemList items;
+    int start, total; // total is TotalRecordCount, -1 if the server left it out
+    int tag;          // for the caller
+    char max_saved[40]; // newest DateLastSaved on the page, if it was asked for
+    bool ok;
+};
+
+// Fetches items [start, start + limit) of query_url. done gets the
+// LibraryPage as r->user and must release it with library_page_free().
+u32 library_fetch(const char* query_url, int start, int limit, int tag, NetDone done);
+void library_page_free(LibraryPage* p);
+
+extern StringArena library_strings; // backs every list on the main thread
+extern ItemList library_albums;      // in the server's SortName order
+// Strings interned by pages and search results outlive their lists, so the
+// arena is compacted on save, and by library_trim() once it has doubled.
+// Any other list on library_strings must be registered to be remapped.
+void library_keep(ItemList* list);
+void library_trim(); // after replacing a kept list
+
+bool library_load(const char* server_url); // false if there is no snapshot for this server
+void library_save();                       // no-op when nothing changed
+void library_sync();                       // background refresh against library_load's server
+bool library_syncing();
+bool library_partial();                    // albums still arriving on a first sync
+std::string library_albums_query();        // what the albums are fetched with, for server-side search
+bool library_take_changed();               // albums changed since the last call
+
+const ItemList* library_tracks(const ItemId& album); // NULL if not held
+void library_store_tracks(const ItemId& album, const ItemList& tracks);
@@ -1,7 +1,6 @@
 #include <3ds.h>
 #include <citro2d.h>
 #include <citro3d.h>
-#include <curl/curl.h>
 #include <json-c/json.h>
 #include <malloc.h>
 #include <stdio.h>
@@ -11,23 +10,39 @@
 #include <string>
 #include <vector>
 #include <algorithm>
-#include <random>
 #include <sys/stat.h>
-#include <jpeglib.h>
 
 
 #include <gfx/icons.h> 
+#include "abr.h"
+#include "audio.h"
+#include "stream.h"
+#include "art.h"
+#include "net.h"
+#include "library.h"
+#include "search.h"
+#include "queue.h"
+#include "text.h"
+#include "thumbs.h"
+#include "trace.h"
 
 // --- Configs and other junk ---
 #define CONFIG_DIR      "sdmc:/3ds/JellyCTR"
 #define CONFIG_PATH     "sdmc:/3ds/JellyCTR/config.txt"
 #define ICONS_PATH      "sdmc:/3ds/JellyCTR/icons.t3x"
+#define TRACE_PATH      "sdmc:/3ds/JellyCTR/trace.bin"
+#define TRACE_PREV_PATH "sdmc:/3ds/JellyCTR/trace.prev.bin"
 #define SOC_ALIGN       0x1000
 #define SOC_BUFFERSIZE  0x100000 
-#define MAX_JSON_SIZE   (512 * 1024)
-#define AUDIO_BUF_SIZE  (32 * 1024) 
-#define NUM_BUFFERS     16
-#define HARDWARE_RATE   48000 
+
+// Album grid on the bottom screen: cells hold a THUMB_SIZE cover, the
+// selected album's name runs above them, the letter strip to the right
+#define GRID_COLS       4
+#define GRID_ROWS       3
+#define GRID_CELL       72
+#define GRID_LEFT       4
+#define GRID_TOP        24
+#define GRID_AHEAD      2 // rows fetched below the visible ones, and half that above
 
 // Theme hardcoded for now
 #define CLR_BLACK       C2D_Color32(0, 0, 0, 255)
@@ -39,319 +54,867 @@
 enum LoopMode { LOOP_OFF, LOOP_ALL, LOOP_ONE };
 enum AppState { STATE_ALBUMS, STATE_SONGS, STATE_PLAYER };
 
-struct MusicItem { 
-    std::string Name, Id, Album;
-    int64_t DurationTicks;
-};
-
 // --- Globals (yeah yeah, I know, globals suck) ---
 AppState current_state = STATE_ALBUMS;
-std::vector<MusicItem> current_list;
+ItemList current_list(&library_strings);
 std::vector<int> playback_queue;
 int queue_index = 0, scroll_index = 0, repeat_timer = 0, y_hold_timer = 0;
+bool scrubbing = false;      // L/R or the seek bar held; scrub_sec is shown until release seeks there
+double scrub_sec = 0;
+int scrub_timer = 0, seek_note_timer = 0;
+u32 seeks_seen = 0;
 bool is_shuffled = false;
 bool is_playing = false; 
 LoopMode loop_mode = LOOP_OFF;
 
-u8* audio_ptr = NULL;
-ndspWaveBuf waveBuf[NUM_BUFFERS];
-volatile int write_node = 0; 
-size_t buf_pos = 0;
-volatile uint64_t total_samples_played = 0;
-volatile bool thread_run = false, is_paused = false;
+volatile bool is_paused = false;
+u32 session_codec = CODEC_PCM; // SELECT cycles it, then auto; applies from the next track
+Stream streams[2];             // playing + prefetching the next queue item
+int cur_stream = 0, prefetch_item = -1;
+// Auto quality (abr=1, or SELECT past the codecs) walks abr_ladder, no
+// higher than max_kbps when that is set; see abr.h
+u32 abr_on = 0, max_kbps = 0;
+AbrState abr;
+int abr_rung = 0;                // rung of the last network stream opened
+int stream_rung[2] = { -1, -1 }; // per stream, -1 when not on the ladder
+u32 abr_bytes_seen = 0, abr_us_seen = 0, abr_stalls_seen = 0;
 
-char current_song_name[128], current_album_name[128], current_song_id[64];
+char current_song_name[128], current_album_name[128];
 double current_duration_seconds = 0;
-pthread_t play_thread;
 char access_token[256], server_url[256]; 
-char* json_buffer = NULL;
-size_t json_len = 0;
+u32 list_request = 0;  // in-flight list page
+int list_request_start = 0, list_next = 0, list_total = 0; // list_next: StartIndex of the next page
+std::string list_query; // current_list's source, for further pages
+ItemId list_album;      // album whose tracks current_list holds
+SearchIndex list_index; // over current_list, rebuilt when next needed
+bool list_index_stale = true;
+char search_text[64];   // the open list's search, "" when there is none
+std::vector<int> list_view; // current_list positions matching search_text
+bool search_remote = false; // current_list is the server's SearchTerm result for search_text
+std::string search_base;    // list query the server search stands in for
 static u32* soc_buffer = NULL;
 
 C3D_RenderTarget *top_target, *bottom_target;
-C2D_TextBuf g_dynamicBuf;
-C3D_Tex album_art_tex;
-C2D_Image album_art_image;
-bool has_album_art = false;
+// Each line of text on screen keeps its parse; see text.h
+TextLine line_codec, line_loading, line_song, line_album, line_time, line_seek, line_search, line_stats, line_next_head;
+TextLine line_next[2], line_rows[10]; // rows by list position % 10, so scrolling by one reparses one row
+C2D_TextBuf letters_buf;             // the letter strip never changes
+C2D_Text letter_text[SEARCH_BUCKETS];
+u32 list_gen = 0, track_gen = 0, queue_gen = 0; // bumped when the list view, playing track or queue change
+bool force_redraw = true;            // both screens, e.g. after an applet drew over them
+u32 wifi_level = 0, battery_level = 0;
+
+// CPU time per frame outside the vsync wait, and how often each screen was
+// really drawn, summed over a second. frame_stats (config.txt): 1 shows it,
+// 2 also redraws every frame, to compare against.
+u32 frame_stats = 0;
+struct FrameTiming { u64 busy_ticks, max_ticks; u32 frames, top_draws, bottom_draws, parses; };
+FrameTiming frame_acc, frame_last;
+u32 frame_stats_gen = 0;
+
+// Telemetry overlay over the bottom screen, toggled with Y+X or overlay=1,
+// refreshed once a second. trace=1 also logs to TRACE_PATH; see trace.h.
+u32 overlay_on = 0, trace_on = 0;
+struct Telemetry {
+    u32 stream_kbps, heap_kb, linear_free_kb;
+    u32 decode_pct, decode_speed_pct; // a core's time spent decoding, and frames decoded against real time
+    u32 net_requests[NET_KIND_COUNT], connect_ms[NET_KIND_COUNT], first_byte_ms[NET_KIND_COUNT]; // over the last second
+};
+Telemetry telemetry;
+NetStats net_seen[NET_KIND_COUNT];
+DecoderStats decode_seen[2];
+u32 stream_bytes_seen = 0, overlay_gen = 0;
+TextLine line_overlay[10];
+
+// albums=list in config.txt keeps the text list; grid_top is the first row shown
+u32 album_view = 0;
+static const char* const album_view_names[] = { "grid", "list", NULL };
+int grid_top = 0;
+TextLine line_grid_name;
+char now_playing_art[64];       // art cache key of the playing item
 C2D_SpriteSheet sprite_sheet;
 
 // --- Logic Helpers ---
 
-void build_queue(int start_index) {
-    playback_queue.clear();
-    for (int i = 0; i < (int)current_list.size(); i++) playback_queue.push_back(i);
-    if (is_shuffled) {
-        std::random_device rd; std::mt19937 g(rd());
-        std::shuffle(playback_queue.begin(), playback_queue.end(), g);
-        for (int i = 0; i < (int)playback_queue.size(); i++) {
-            if (playback_queue[i] == start_index) { std::swap(playback_queue[0], playback_queue[i]); break; }
-        }
-    } else {
-        std::rotate(playback_queue.begin(), playback_queue.begin() + start_index, playback_queue.end());
-    }
-    queue_index = 0;
+// Queues items (current_list positions) from start_item on; unshuffled they play in list order
+void build_queue(const std::vector<int>& items, int start_item) {
+    queue_build(playback_queue, items, start_item, is_shuffled);
+    queue_index = 0; queue_gen++;
 }
 
-void ask_for_input(char* out, size_t buf_size, const char* hint, SwkbdType type, bool password) {
+// Starts the keyboard on what out already holds
+SwkbdButton ask_for_input(char* out, size_t buf_size, const char* hint, SwkbdType type, bool password) {
     SwkbdState swkbd;
     swkbdInit(&swkbd, type, 2, -1);
     swkbdSetHintText(&swkbd, hint);
+    swkbdSetInitialText(&swkbd, out);
     if (password) swkbdSetPasswordMode(&swkbd, SWKBD_PASSWORD_HIDE_DELAY);
-    swkbdInputText(&swkbd, out, buf_size); 
-}
-
-uint32_t get_tiled_offset(uint32_t x, uint32_t y, uint32_t w) {
-    return ((((y >> 3) * (w >> 3) + (x >> 3)) << 6) + ((x & 1) << 0) + ((y & 1) << 1) + ((x & 2) << 1) + ((y & 2) << 2) + ((x & 4) << 2) + ((y & 4) << 3));
-}
-
-void decode_jpeg(u8* src_data, size_t src_size) {
-    if (src_size < 100) return;
-    if (has_album_art) { C3D_TexDelete(&album_art_tex); has_album_art = false; }
-    
-    struct jpeg_decompress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    cinfo.err = jpeg_std_error(&jerr);
-    jpeg_create_decompress(&cinfo);
-    jpeg_mem_src(&cinfo, src_data, src_size);
-    if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) { jpeg_destroy_decompress(&cinfo); return; }
-    
-    cinfo.out_color_space = JCS_RGB; 
-    jpeg_start_decompress(&cinfo);  
-    C3D_TexInit(&album_art_tex, 256, 256, GPU_RGBA8);
-    u32* flat_pixels = (u32*)linearAlloc(256 * 256 * 4);
-    if (!flat_pixels) return;
-    memset(flat_pixels, 0, 256 * 256 * 4);
-
-    u8* row_ptr = (u8*)malloc(cinfo.output_width * 3);
-    while (cinfo.output_scanline < cinfo.output_height && cinfo.output_scanline < 256) {
-        jpeg_read_scanlines(&cinfo, &row_ptr, 1);
-        for(u32 x = 0; x < cinfo.output_width && x < 256; x++) {
-            u8 r = row_ptr[x * 3], g = row_ptr[x * 3 + 1], b = row_ptr[x * 3 + 2];
-            flat_pixels[(cinfo.output_scanline - 1) * 256 + x] = (0xFF) | (b << 8) | (g << 16) | (r << 24);
-        }
+    force_redraw = true;
+    return swkbdInputText(&swkbd, out, buf_size); 
+}
+
+// config.txt: server URL and token on the first two lines, then key=value tunables
+struct Setting { const char* key; u32* value; const char* const* names; };
+static const Setting settings[] = {
+    { "prebuffer_ms", &audio_config.prebuffer_ms, NULL },
+    { "rebuffer_ms",  &audio_config.rebuffer_ms, NULL },
+    { "ring_ms",      &audio_config.ring_ms, NULL },
+    { "codec",        &session_codec, codec_names },
+    { "abr",          &abr_on, NULL },
+    { "max_kbps",     &max_kbps, NULL },
+    { "albums",       &album_view, album_view_names },
+    { "cache_mb",     &cache_config.max_mb, NULL },
+    { "art_cache_kb", &art_config.cache_kb, NULL },
+    { "frame_stats",  &frame_stats, NULL },
+    { "overlay",      &overlay_on, NULL },
+    { "trace",        &trace_on, NULL },
+};
+
+static u32 parse_setting(const Setting& st, const char* val) {
+    if (!st.names) return (u32)strtoul(val, NULL, 10);
+    for (u32 i = 0; st.names[i]; i++) if (!strncmp(val, st.names[i], strlen(st.names[i]))) return i;
+    return 0;
+}
+
+bool load_config() {
+    FILE* cfg = fopen(CONFIG_PATH, "r");
+    if (!cfg) return false;
+    fscanf(cfg, "%255s\n%255s", server_url, access_token);
+    char line[128];
+    while (fgets(line, sizeof(line), cfg)) {
+        char* eq = strchr(line, '=');
+        if (!eq) continue;
+        *eq = '\0';
+        for (const Setting& st : settings) if (!strcmp(line, st.key)) *st.value = parse_setting(st, eq + 1);
     }
-    free(row_ptr);
-
-    u32* tex_data = (u32*)album_art_tex.data;
-    for (u32 y = 0; y < 256; y++) for (u32 x = 0; x < 256; x++) tex_data[get_tiled_offset(x, y, 256)] = flat_pixels[y * 256 + x];
-    GSPGPU_FlushDataCache(album_art_tex.data, 256 * 256 * 4);
-
-    if (cinfo.output_scanline < cinfo.output_height) jpeg_abort_decompress(&cinfo);
-    else jpeg_finish_decompress(&cinfo);
-    
-    jpeg_destroy_decompress(&cinfo);
-    linearFree(flat_pixels);
-    album_art_image.tex = &album_art_tex;
-    static Tex3DS_SubTexture sub = { 256, 256, 0.0f, 1.0f, 1.0f, 0.0f };
-    album_art_image.subtex = &sub;
-    has_album_art = true;
-}
-
-size_t audio_callback(void *ptr, size_t size, size_t nmemb, void *userdata) {
-    if (!thread_run) return 0;
-    while (is_paused && thread_run) svcSleepThread(10000000);
-    size_t total = size * nmemb; u8* data = (u8*)ptr;
-    for (size_t i = 0; i < total; i++) {
-        while (thread_run && waveBuf[write_node].status != NDSP_WBUF_FREE && waveBuf[write_node].status != NDSP_WBUF_DONE) svcSleepThread(500000); 
-        if (!thread_run) return 0;
-        audio_ptr[write_node * AUDIO_BUF_SIZE + buf_pos] = data[i];
-        buf_pos++;
-        if (buf_pos >= AUDIO_BUF_SIZE) {
-            DSP_FlushDataCache(audio_ptr + (write_node * AUDIO_BUF_SIZE), AUDIO_BUF_SIZE);
-            waveBuf[write_node].nsamples = AUDIO_BUF_SIZE / 4; 
-            ndspChnWaveBufAdd(0, &waveBuf[write_node]);
-            total_samples_played += (AUDIO_BUF_SIZE / 4);
-            write_node = (write_node + 1) % NUM_BUFFERS; buf_pos = 0;
-        }
+    fclose(cfg);
+    return true;
+}
+
+void save_config() {
+    FILE* fw = fopen(CONFIG_PATH, "w");
+    if (!fw) return;
+    fprintf(fw, "%s\n%s\n", server_url, access_token);
+    for (const Setting& st : settings) {
+        if (st.names) {
+            u32 n = 0; while (st.names[n]) n++;
+            fprintf(fw, "%s=%s\n", st.key, st.names[*st.value < n ? *st.value : 0]); // never index past the table
+        } else fprintf(fw, "%s=%lu\n", st.key, (unsigned long)*st.value);
     }
-    return total;
+    fclose(fw);
 }
 
 void stop_playback() {
-    if (thread_run) { thread_run = false; is_paused = false; pthread_join(play_thread, NULL); }
-    ndspChnReset(0);
+    is_paused = false;
+    audio_stop();
+    stream_close(&streams[0]); stream_close(&streams[1]);
+    prefetch_item = -1;
+}
+
+// A codec picked with SELECT, at its usual bitrate
+Rendition fixed_rendition(Codec codec) { Rendition r = { codec, codec_kbps[codec], codec_names[codec] }; return r; }
+
+// Transcode parameters; these also key the SD cache
+void stream_params(char* out, size_t n, const Rendition& r) {
+    char rate[32] = "";
+    if (r.kbps) snprintf(rate, sizeof(rate), "&audioBitRate=%lu000", (unsigned long)r.kbps);
+    snprintf(out, n, "%s%s&audioChannels=2&audioSampleRate=48000&maxSampleRate=48000&targetSampleRate=48000", codec_queries[r.codec], rate);
+}
+
+// Items are addressed by their index in current_list. A stream for a seek
+// starts at start_frame; the cache key stays that of the whole track.
+void stream_source(int item, const Rendition& r, char* url, size_t url_len, char* key, u64 start_frame = 0) {
+    char params[256]; stream_params(params, sizeof(params), r);
+    char id[ITEM_ID_HEX]; item_id_format(current_list.ids[item], id);
+    snprintf(url, url_len, "%s/Audio/%s/stream?static=false&%s&api_key=%s", server_url, id, params, access_token);
+    if (start_frame) { size_t n = strlen(url); snprintf(url + n, url_len - n, "&StartTimeTicks=%llu", (unsigned long long)(start_frame * 10000000ULL / HARDWARE_RATE)); }
+    cache_make_key(key, id, params);
+}
+
+bool start_stream(Stream* st, int item, u64 start_frame = 0) {
+    char url[1024], key[CACHE_KEY_LEN];
+    int rung = abr_on ? abr_choose(abr, abr_rung, abr_cap_rung(max_kbps)) : -1;
+    Rendition r = rung >= 0 ? abr_ladder[rung] : fixed_rendition((Codec)session_codec);
+    // A cached copy at any quality beats going to the network
+    for (int c = 0; c < CODEC_COUNT + ABR_RUNGS; c++) {
+        Rendition cr = c < CODEC_COUNT ? fixed_rendition((Codec)c) : abr_ladder[c - CODEC_COUNT];
+        stream_source(item, cr, url, sizeof(url), key);
+        if (cache_has(key)) { r = cr; rung = -1; break; }
+    }
+    for (;;) {
+        stream_source(item, r, url, sizeof(url), key, start_frame);
+        if (stream_open(st, url, r.codec, key, start_frame)) break;
+        if (r.codec == CODEC_PCM) return false;
+        r = fixed_rendition(CODEC_PCM); rung = -1; // no decoder thread, fall back to raw
+    }
+    stream_rung[st - streams] = rung;
+    if (rung >= 0) { abr_rung = rung; trace_counter(TRACE_RENDITION_KBPS, TRACE_LANE_MAIN, r.kbps); }
+    return true;
+}
+
+// Tracks share their album's cover, so key art by album where we know it
+void art_key(int item, char* out) { item_id_format(current_list.parents[item].empty() ? current_list.ids[item] : current_list.parents[item], out); }
+
+void want_art(int item) {
+    char key[ITEM_ID_HEX]; art_key(item, key);
+    char url[1024]; snprintf(url, sizeof(url), "%s/Items/%s/Images/Primary?maxWidth=%d&maxHeight=%d&api_key=%s", server_url, key, ART_MAX_SIZE, ART_MAX_SIZE, access_token);
+    art_want(key, url, ART_MAX_SIZE);
+}
+
+// Requests covers for the Next Up entries, then the playing one so it is served first
+void want_queue_art() {
+    art_clear_pending();
+    for (int i = 2; i >= 1; i--) if (queue_index + i < (int)playback_queue.size()) want_art(playback_queue[queue_index + i]);
+    if (queue_index < (int)playback_queue.size()) want_art(playback_queue[queue_index]);
+}
+
+// Art arrives later from the worker; see art_collect()
+void set_now_playing(int item) {
+    track_gen++;
+    art_key(item, now_playing_art);
+    want_queue_art();
+    strncpy(current_song_name, current_list.name(item), 127); strncpy(current_album_name, current_list.album(item), 127);
+    current_duration_seconds = current_list.duration_ms[item] / 1000.0;
+}
+
+// Draws the cover scaled to a fixed on-screen size, whatever it decoded to
+void draw_album_art(const char* key, float x, float y, float size) {
+    const C2D_Image* img = art_get(key);
+    if (!img) return;
+    float sc = size / (img->subtex->width > img->subtex->height ? img->subtex->width : img->subtex->height);
+    C2D_DrawImageAt(*img, x, y, 0.5f, NULL, sc, sc);
 }
 
-void play_song(const MusicItem& item) {
+void play_song(int item) {
     stop_playback();
     is_playing = true; 
     current_state = STATE_PLAYER;
-    struct DLBuf { u8* b; size_t s; } d; d.b = (u8*)malloc(512 * 1024); d.s = 0;
-    CURL* c = curl_easy_init();
-    char url[1024]; snprintf(url, sizeof(url), "%s/Items/%s/Images/Primary?maxWidth=256&api_key=%s", server_url, item.Id.c_str(), access_token);
-    curl_easy_setopt(c, CURLOPT_URL, url);
-    curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, +[](void* p, size_t s, size_t n, void* u) -> size_t {
-        struct DLBuf* db = (struct DLBuf*)u;
-        memcpy(db->b + db->s, p, s*n); db->s += s*n; return s*n;
-    });
-    curl_easy_setopt(c, CURLOPT_WRITEDATA, &d);
-    curl_easy_setopt(c, CURLOPT_SSL_VERIFYPEER, 0L);
-    if (curl_easy_perform(c) == CURLE_OK) decode_jpeg(d.b, d.s);
-    curl_easy_cleanup(c); free(d.b);
-    strncpy(current_song_id, item.Id.c_str(), 63); strncpy(current_song_name, item.Name.c_str(), 127); strncpy(current_album_name, item.Album.c_str(), 127);
-    current_duration_seconds = (double)item.DurationTicks / 10000000.0;
-    total_samples_played = 0; write_node = 0; buf_pos = 0;
-    ndspChnReset(0); ndspChnInitParams(0); ndspChnSetFormat(0, NDSP_FORMAT_STEREO_PCM16); ndspChnSetRate(0, HARDWARE_RATE);
-    for(int i=0; i<NUM_BUFFERS; i++) waveBuf[i].status = NDSP_WBUF_FREE;
-    thread_run = true;
-    pthread_create(&play_thread, NULL, [](void* arg) -> void* {
-        CURL *curl = curl_easy_init(); char stream[2048]; 
-        snprintf(stream, sizeof(stream), "%s/Audio/%s/stream?static=false&audioCodec=pcm_s16le&container=raw&audioSampleRate=48000&maxSampleRate=48000&targetSampleRate=48000&audioBitRate=1536000&api_key=%s", server_url, current_song_id, access_token);
-        curl_easy_setopt(curl, CURLOPT_URL, stream); curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, audio_callback); curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-        curl_easy_perform(curl); curl_easy_cleanup(curl); thread_run = false; return NULL;
-    }, NULL);
+    set_now_playing(item);
+    if (start_stream(&streams[cur_stream], item)) audio_play(&streams[cur_stream].pcm);
 }
 
 void play_current_queue_item() {
     if (playback_queue.empty()) return;
-    play_song(current_list[playback_queue[queue_index]]);
+    play_song(playback_queue[queue_index]);
+}
+
+// Queue position that follows queue_index under the current loop mode, or -1
+int next_queue_pos() {
+    if (loop_mode == LOOP_ONE) return queue_index;
+    if (queue_index < (int)playback_queue.size() - 1) return queue_index + 1;
+    if (loop_mode == LOOP_ALL && !playback_queue.empty()) return 0;
+    return -1;
+}
+
+// Once the current track is fully downloaded, open the next one into the
+// spare stream and queue its ring behind the current one.
+void update_prefetch() {
+    if (!is_playing || prefetch_item >= 0 || !streams[cur_stream].net_done || audio_get_stats().buffering) return;
+    int pos = next_queue_pos();
+    if (pos < 0) return;
+    Stream* st = &streams[cur_stream ^ 1];
+    if (!start_stream(st, playback_queue[pos])) return;
+    if (audio_queue_next(&st->pcm)) prefetch_item = playback_queue[pos];
+    else stream_close(st);
+}
+
+// Drops a prefetch that no longer matches the queue. If the feeder already
+// spliced it in, it stays and the switch lands as usual.
+void invalidate_prefetch() {
+    if (prefetch_item < 0 || !audio_queue_next(NULL)) return;
+    stream_close(&streams[cur_stream ^ 1]);
+    prefetch_item = -1;
+}
+
+// The queued ring reached the speaker: retire the old stream and catch the UI up.
+void on_track_switched() {
+    stream_close(&streams[cur_stream]);
+    cur_stream ^= 1;
+    for (int i = 0; i < (int)playback_queue.size(); i++) if (playback_queue[i] == prefetch_item) { queue_index = i; break; }
+    prefetch_item = -1;
+    set_now_playing(playback_queue[queue_index]);
 }
 
 void next_track() {
-    if (loop_mode == LOOP_ONE) { /* we love our loops */ }
-    else if (queue_index < (int)playback_queue.size() - 1) queue_index++;
-    else if (loop_mode == LOOP_ALL) queue_index = 0;
-    else { 
+    int pos = next_queue_pos();
+    if (pos < 0) { 
         stop_playback(); 
         is_playing = false; 
         return; 
     }
+    queue_index = pos;
+    // Skipping onto the prefetched item: promote its stream instead of reconnecting
+    if (prefetch_item == playback_queue[pos] && audio_queue_next(NULL)) {
+        audio_stop(); stream_close(&streams[cur_stream]);
+        cur_stream ^= 1; prefetch_item = -1; is_paused = false;
+        set_now_playing(playback_queue[pos]);
+        audio_play(&streams[cur_stream].pcm);
+        return;
+    }
     play_current_queue_item();
 }
 
 void prev_track() {
-    if (total_samples_played / 48000.0 > 3.0) play_current_queue_item();
+    if (audio_get_stats().position / (double)HARDWARE_RATE > 3.0) play_current_queue_item();
     else if (queue_index > 0) { queue_index--; play_current_queue_item(); }
 }
 
+// Restarts the playing track at frame on a fresh stream, as paused as it
+// was. The prefetched next track comes back through update_prefetch().
+void reopen_at(u64 frame, u64 seek_tick) {
+    bool paused = is_paused;
+    stop_playback();
+    Stream* st = &streams[cur_stream];
+    if (!start_stream(st, playback_queue[queue_index], frame)) return;
+    audio_play(&st->pcm, frame, paused ? 0 : seek_tick);
+    if (paused) { is_paused = true; audio_set_paused(true); }
+}
+
+// Seeks the playing track. A target already in the PCM ring is served from
+// there; anything else reopens the stream at it, from the SD cache when the
+// track is stored or with StartTimeTicks on the server.
+void seek_to(double sec) {
+    if (!is_playing || playback_queue.empty() || current_duration_seconds <= 0) return;
+    if (sec > current_duration_seconds - 1) sec = current_duration_seconds - 1;
+    if (sec < 0) sec = 0;
+    u64 frame = (u64)(sec * HARDWARE_RATE);
+    if (audio_seek(frame)) return;
+    reopen_at(frame, svcGetSystemTick());
+}
+
+// Once a second: feeds the ABR the link rate and buffer level. In auto
+// quality, a network stream that has stalled for a while is reopened where
+// it is, lower down the ladder, rather than waiting for the next track.
+void abr_tick(const AudioStats& as) {
+    u32 bytes, us; stream_timed(&bytes, &us);
+    u32 bytes_per_ms = HARDWARE_RATE / 1000 * FRAME_BYTES;
+    AbrSample in;
+    in.bytes = bytes - abr_bytes_seen; in.us = us - abr_us_seen;
+    abr_bytes_seen = bytes; abr_us_seen = us;
+    in.buffer_ms = (as.ring_fill + as.dsp_queued * AUDIO_BUF_SIZE) / bytes_per_ms; in.cap_ms = as.ring_size / bytes_per_ms;
+    in.stalled = as.underruns + as.rebuffers != abr_stalls_seen; abr_stalls_seen = as.underruns + as.rebuffers;
+    in.buffering = is_playing && as.buffering;
+    abr_update(abr, in);
+    trace_counter(TRACE_LINK_KBPS, TRACE_LANE_MAIN, abr.rate_kbps);
+    int rung = stream_rung[cur_stream];
+    if (!is_playing || rung < 0 || streams[cur_stream].net_done) return;
+    int to = abr_reopen(abr, rung, abr_cap_rung(max_kbps));
+    if (to < 0) return;
+    abr.stall_s = 0; abr_rung = to;
+    reopen_at(as.position, 0);
+}
+
+// Pins the open album for offline play, or unpins it if it already is
+void toggle_album_pin() {
+    bool all_pinned = true;
+    char id[ITEM_ID_HEX];
+    for (size_t i = 0; i < current_list.size(); i++) { item_id_format(current_list.ids[i], id); if (cache_item_state(id) != CACHE_PINNED) all_pinned = false; }
+    for (size_t i = 0; i < current_list.size(); i++) {
+        item_id_format(current_list.ids[i], id);
+        if (all_pinned) { cache_unpin(id); continue; }
+        char url[1024], key[CACHE_KEY_LEN];
+        stream_source(i, abr_on ? abr_ladder[abr_cap_rung(max_kbps)] : fixed_rendition((Codec)session_codec), url, sizeof(url), key);
+        cache_pin(id, key, url);
+    }
+}
+
+void toggle_shuffle() {
+    is_shuffled = !is_shuffled;
+    if (!playback_queue.empty()) { std::vector<int> items = playback_queue; build_queue(items, playback_queue[queue_index]); }
+    invalidate_prefetch();
+    want_queue_art();
+}
+
 bool perform_login() {
     char username[128] = {0}, password[128] = {0};
     ask_for_input(server_url, 256, "Server URL (http://ip:8096)", SWKBD_TYPE_NORMAL, false);
     ask_for_input(username, 128, "Username", SWKBD_TYPE_NORMAL, false);
     ask_for_input(password, 128, "Password", SWKBD_TYPE_NORMAL, true);
-    CURL *curl = curl_easy_init();
     char login_url[512]; snprintf(login_url, sizeof(login_url), "%s/Users/AuthenticateByName", server_url);
     struct json_object *jobj = json_object_new_object();
     json_object_object_add(jobj, "Username", json_object_new_string(username));
     json_object_object_add(jobj, "Pw", json_object_new_string(password));
-    const char* post_data = json_object_to_json_string(jobj);
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
-    headers = curl_slist_append(headers, "X-Emby-Authorization: MediaBrowser Client=\"JellyCTR\", Device=\"3DS\", Version=\"0.2\"");
-    json_len = 0; curl_easy_setopt(curl, CURLOPT_URL, login_url); curl_easy_setopt(curl, CURLOPT_POSTFIELDS, post_data);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, +[](void* ptr, size_t s, size_t n, void* u) -> size_t {
-        size_t t = s * n; if (json_len + t < MAX_JSON_SIZE - 1) { memcpy(json_buffer + json_len, ptr, t); json_len += t; json_buffer[json_len] = '\0'; }
-        return t;
-    });
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-    bool success = false;
-    if(curl_easy_perform(curl) == CURLE_OK) {
-        struct json_object *parsed = json_tokener_parse(json_buffer), *token_obj;
+    // Modal behind the keyboard anyway, so this one may block
+    NetResult r; bool success = false;
+    if (net_fetch(login_url, json_object_to_json_string(jobj), &r)) {
+        struct json_object *parsed = json_tokener_parse(r.body), *token_obj;
         if (parsed && json_object_object_get_ex(parsed, "AccessToken", &token_obj)) {
             strncpy(access_token, json_object_get_string(token_obj), 255); success = true;
+            net_set_token(access_token);
         }
         if (parsed) json_object_put(parsed);
     }
-    curl_slist_free_all(headers); curl_easy_cleanup(curl); json_object_put(jobj);
+    free(r.body); json_object_put(jobj);
     return success;
 }
 
-void fetch_items(const std::string& query_url) {
-    json_len = 0; current_list.clear();
-    CURL *curl = curl_easy_init(); struct curl_slist *h = NULL;
-    char auth[512]; snprintf(auth, sizeof(auth), "X-Emby-Authorization: MediaBrowser Client=\"JellyCTR\", Token=\"%s\"", access_token);
-    h = curl_slist_append(h, auth); curl_easy_setopt(curl, CURLOPT_URL, query_url.c_str()); curl_easy_setopt(curl, CURLOPT_HTTPHEADER, h);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, +[](void* ptr, size_t s, size_t n, void* u) -> size_t {
-        size_t t = s * n; if (json_len + t < MAX_JSON_SIZE - 1) { memcpy(json_buffer + json_len, ptr, t); json_len += t; json_buffer[json_len] = '\0'; }
-        return t;
-    });
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-    if(curl_easy_perform(curl) == CURLE_OK) {
-        struct json_object *parsed = json_tokener_parse(json_buffer), *items;
-        if (parsed) { 
-            if (json_object_object_get_ex(parsed, "Items", &items)) {
-                for (size_t i = 0; i < (size_t)json_object_array_length(items); i++) {
-                    struct json_object *it = json_object_array_get_idx(items, i), *n, *id, *alb, *dur;
-                    MusicItem mi;
-                    if (json_object_object_get_ex(it, "Name", &n)) mi.Name = json_object_get_string(n);
-                    if (json_object_object_get_ex(it, "Id", &id)) mi.Id = json_object_get_string(id);
-                    if (json_object_object_get_ex(it, "Album", &alb)) mi.Album = json_object_get_string(alb); else mi.Album = "Unknown Album";
-                    if (json_object_object_get_ex(it, "RunTimeTicks", &dur)) mi.DurationTicks = json_object_get_int64(dur);
-                    current_list.push_back(mi);
-                }
-            }
-            json_object_put(parsed); 
+// --- List view ---
+// The list UI walks current_list through a view: every item, or the search hits.
+// scroll_index is a position in the view.
+bool filtering() { return search_text[0] && !search_remote; }
+int view_size() { return filtering() ? (int)list_view.size() : (int)current_list.size(); }
+int view_item(int pos) { return filtering() ? list_view[pos] : pos; }
+
+int view_pos(int item) {
+    if (!filtering()) return item;
+    std::vector<int>::iterator it = std::lower_bound(list_view.begin(), list_view.end(), item);
+    return it != list_view.end() && *it == item ? (int)(it - list_view.begin()) : 0;
+}
+
+const SearchIndex& index_list() {
+    if (list_index_stale) { list_index.build(current_list); list_index_stale = false; }
+    return list_index;
+}
+
+// current_list changed under the view; a search stays applied to the new items
+void list_changed() {
+    list_index_stale = true; list_gen++;
+    if (filtering()) search_match(index_list(), search_text, list_view);
+}
+
+void reset_search() { search_text[0] = '\0'; search_remote = false; list_view.clear(); list_gen++; }
+
+// Lists load a page at a time on the net worker; the view switches once the first page is in
+void on_items(const NetResult* r) {
+    LibraryPage* p = (LibraryPage*)r->user;
+    if (r->id == list_request) list_request = 0;
+    if (!r->cancelled && p->ok && r->status < 400) {
+        bool first = p->start == 0;
+        if (first || (p->start == list_next && current_state == (AppState)p->tag)) {
+            if (first) { current_list.clear(); library_trim(); current_state = (AppState)p->tag; scroll_index = 0; }
+            current_list.append(p->items); // re-interned into library_strings
+            list_next = p->start + LIBRARY_PAGE;
+            list_total = p->total < 0 ? list_next : p->total;
+            list_changed();
+            // Complete track lists are kept so reopening the album is instant
+            if (current_state == STATE_SONGS && !search_remote && list_next >= list_total) library_store_tracks(list_album, current_list);
         }
     }
-    curl_slist_free_all(h); curl_easy_cleanup(curl);
+    library_page_free(p);
+}
+
+void fetch_items(const std::string& query_url, AppState target) {
+    net_cancel(list_request);
+    list_query = query_url; list_total = list_next = 0;
+    list_request = library_fetch(query_url.c_str(), 0, LIBRARY_PAGE, target, on_items);
+    list_request_start = 0;
 }
 
-void draw_status_bar() {
-    int wifi = (int)osGetWifiStrength();
-    if (wifi > 0 && sprite_sheet) {
-        C2D_Image w = C2D_SpriteSheetGetImage(sprite_sheet, icons_wifi_min_idx + (wifi - 1));
+// Albums always come from the library snapshot; select keeps the cursor on that album
+void show_albums(const ItemId* select) {
+    net_cancel(list_request); list_request = 0;
+    current_list = library_albums; list_total = list_next = 0;
+    library_trim();
+    current_state = STATE_ALBUMS; scroll_index = 0;
+    list_changed();
+    int at = select ? current_list.find(*select) : -1;
+    if (at >= 0) scroll_index = view_pos(at);
+}
+
+void open_album(int album) {
+    list_album = current_list.ids[album];
+    const ItemList* tracks = library_tracks(list_album);
+    if (!tracks) {
+        char id[ITEM_ID_HEX]; item_id_format(list_album, id);
+        fetch_items(std::string(server_url) + "/Items?ParentId=" + id + "&SortBy=ParentIndexNumber,IndexNumber,SortName", STATE_SONGS);
+        return;
+    }
+    net_cancel(list_request); list_request = 0;
+    current_list = *tracks; list_total = list_next = (int)current_list.size();
+    library_trim();
+    current_state = STATE_SONGS; scroll_index = 0;
+    list_changed();
+}
+
+// Pulls in the next page once the cursor gets near the end of what is loaded
+void fetch_more_items() {
+    if (list_request || current_state == STATE_PLAYER || list_next >= list_total || scroll_index + LIBRARY_PAGE / 4 < view_size()) return;
+    list_request = library_fetch(list_query.c_str(), list_next, LIBRARY_PAGE, current_state, on_items);
+    list_request_start = list_next;
+}
+
+// --- Search and jump ---
+std::string url_escape(const char* s) {
+    static const char hex[] = "0123456789ABCDEF";
+    std::string out;
+    for (; *s; s++) {
+        unsigned char c = *s;
+        if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || strchr("-_.~", c)) out += c;
+        else { out += '%'; out += hex[c >> 4]; out += hex[c & 15]; }
+    }
+    return out;
+}
+
+// Drops the search; a server-side one hands back the list it replaced
+void clear_search() {
+    bool remote = search_remote;
+    reset_search();
+    if (!remote) return;
+    if (current_state == STATE_ALBUMS) show_albums(NULL);
+    else fetch_items(search_base, STATE_SONGS);
+}
+
+// Searches the open list. The swkbd applet is modal with no per-key callback,
+// so the filter applies on submit; editing the last search to a longer one
+// only narrows its hits. Lists not fully loaded yet ask the server, since
+// what matches may not have been paged in.
+void open_search() {
+    char text[sizeof(search_text)]; strcpy(text, search_text);
+    if (ask_for_input(text, sizeof(text), "Search", SWKBD_TYPE_NORMAL, false) != SWKBD_BUTTON_CONFIRM) return;
+    if (!text[0]) { clear_search(); return; }
+    bool partial = current_state == STATE_ALBUMS ? library_partial() : list_next < list_total;
+    if (partial || search_remote) {
+        if (!search_remote) search_base = current_state == STATE_ALBUMS ? library_albums_query() : list_query;
+        strcpy(search_text, text); search_remote = true; list_view.clear(); list_gen++;
+        fetch_items(search_base + "&SearchTerm=" + url_escape(text), current_state);
+        return;
+    }
+    std::vector<int> prev; prev.swap(list_view);
+    bool narrows = search_text[0] && !strncmp(text, search_text, strlen(search_text));
+    strcpy(search_text, text);
+    search_match(index_list(), search_text, list_view, narrows ? &prev : NULL);
+    scroll_index = 0; list_gen++;
+}
+
+// Moves the cursor to the first item under letter bucket b, or the next bucket that has one
+void jump_to_bucket(int b) {
+    const SearchIndex& ix = index_list();
+    for (; b < SEARCH_BUCKETS; b++) {
+        if (!filtering()) { if (ix.first[b] >= 0) { scroll_index = ix.first[b]; return; } continue; }
+        for (int pos = 0; pos < view_size(); pos++) if (ix.buckets[view_item(pos)] == b) { scroll_index = pos; return; }
+    }
+}
+
+// Steps to the start of the next letter group (dir > 0), or of this one and then the one before
+void jump_group(int dir) {
+    int n = view_size();
+    if (!n) return;
+    const SearchIndex& ix = index_list();
+    int pos = scroll_index, b = ix.buckets[view_item(pos)];
+    if (dir > 0) {
+        while (pos < n - 1 && ix.buckets[view_item(pos)] == b) pos++;
+    } else {
+        if (pos > 0 && ix.buckets[view_item(pos - 1)] != b) b = ix.buckets[view_item(--pos)];
+        while (pos > 0 && ix.buckets[view_item(pos - 1)] == b) pos--;
+    }
+    scroll_index = pos;
+}
+
+// --- Album grid ---
+bool album_grid() { return current_state == STATE_ALBUMS && album_view == 0; }
+
+// Keeps the cursor's row on screen
+void follow_grid() {
+    int row = scroll_index / GRID_COLS;
+    if (row < grid_top) grid_top = row;
+    if (row >= grid_top + GRID_ROWS) grid_top = row - GRID_ROWS + 1;
+}
+
+// Asks for the covers of the rows on screen, nearest the cursor first, then
+// GRID_AHEAD rows below and half as many above. Whatever the last call asked
+// for and this one doesn't is dropped or cancelled by thumbs_want().
+void want_thumbs() {
+    static u32 gen_seen = 0; static int scroll_seen = -2, top_seen = -1;
+    int scroll = album_grid() ? scroll_index : -1;
+    if (list_gen == gen_seen && scroll == scroll_seen && grid_top == top_seen) return;
+    gen_seen = list_gen; scroll_seen = scroll; top_seen = grid_top;
+    std::vector<ThumbJob> jobs;
+    if (scroll >= 0) {
+        int first = (grid_top - GRID_AHEAD / 2) * GRID_COLS, last = (grid_top + GRID_ROWS + GRID_AHEAD) * GRID_COLS;
+        if (first < 0) first = 0;
+        if (last > view_size()) last = view_size();
+        std::vector<int> order;
+        for (int idx = first; idx < last; idx++) order.push_back(idx);
+        int lo = grid_top * GRID_COLS, hi = lo + GRID_ROWS * GRID_COLS;
+        std::sort(order.begin(), order.end(), [&](int a, int b) {
+            bool va = a >= lo && a < hi, vb = b >= lo && b < hi;
+            if (va != vb) return va;
+            int da = abs(a - scroll), db = abs(b - scroll);
+            return da != db ? da < db : a < b;
+        });
+        for (int idx : order) {
+            ThumbJob j; char key[ITEM_ID_HEX]; art_key(view_item(idx), key);
+            char url[1024]; snprintf(url, sizeof(url), "%s/Items/%s/Images/Primary?maxWidth=%d&maxHeight=%d&api_key=%s", server_url, key, THUMB_SIZE, THUMB_SIZE, access_token);
+            j.key = key; j.url = url;
+            jobs.push_back(j);
+        }
+    }
+    thumbs_want(jobs);
+}
+
+void draw_line(TextLine* l, const char* str, float x, float y, float scale, u32 color) {
+    const C2D_Text* t = text_line(l, str);
+    if (t) C2D_DrawText(t, C2D_WithColor, x, y, 0.5f, scale, scale, color);
+}
+
+// What each screen shows. A screen is drawn only when its view differs from
+// the one last drawn: a target that isn't drawn to isn't transferred, so the
+// previous image stays up. Building the view also touches the art it needs,
+// which keeps art_collect() from evicting it.
+struct TopView {
+    const C2D_Image* art;
+    u32 track, codec, wifi, battery, list_gen, seeks, stats_gen;
+    int elapsed_s, bar_px, list_count;
+    bool loading, buffering, seek_note, searching;
+};
+
+struct BottomView {
+    const C2D_Image* next_art[2];
+    u32 list_gen, cache_gen, queue_gen, overlay_gen;
+    u32 thumbs_shown; // grid cells whose cover is in, a bit each
+    int state, scroll, count, bar_px, queue_pos, grid_top;
+    bool paused, shuffled; int loop;
+};
+
+void draw_status_bar(const TopView& v) {
+    char codec[32];
+    if (v.codec < CODEC_COUNT) snprintf(codec, sizeof(codec), "%s", codec_names[v.codec]);
+    else snprintf(codec, sizeof(codec), "auto %s", abr_ladder[v.codec - CODEC_COUNT].name);
+    draw_line(&line_codec, codec, 280, 8, 0.4f, CLR_DIM);
+    if (v.loading) draw_line(&line_loading, "Loading...", 200, 8, 0.4f, CLR_DIM);
+    if (v.wifi > 0 && sprite_sheet) {
+        C2D_Image w = C2D_SpriteSheetGetImage(sprite_sheet, icons_wifi_min_idx + (v.wifi - 1));
         C2D_DrawImageAt(w, 320, 5, 0.5f, NULL, 0.5f, 0.5f);
     }
-    u8 bat; PTMU_GetBatteryLevel(&bat); 
-    int bat_idx = (bat > 6) ? 6 : bat; 
     if (sprite_sheet) {
-        C2D_Image b = C2D_SpriteSheetGetImage(sprite_sheet, icons_batt_1_idx + bat_idx);
+        C2D_Image b = C2D_SpriteSheetGetImage(sprite_sheet, icons_batt_1_idx + v.battery);
         C2D_DrawImageAt(b, 360, 5, 0.5f, NULL, 0.5f, 0.5f);
     }
 }
 
-void draw_next_up_preview(int x, int y, int q_idx) {
+void draw_top(const TopView& v, const AudioStats& as) {
+    C2D_TargetClear(top_target, CLR_BLACK);
+    C2D_SceneBegin(top_target);
+    draw_status_bar(v);
+    draw_album_art(now_playing_art, 15, 30, 166);
+    char tt_s[64]; snprintf(tt_s, sizeof(tt_s), "%d:%02d/%d:%02d%s", v.elapsed_s/60, v.elapsed_s%60, (int)current_duration_seconds/60, (int)current_duration_seconds%60, v.buffering ? "  Buffering..." : "");
+    draw_line(&line_song, current_song_name, 200, 40, 0.65f, CLR_WHITE); draw_line(&line_album, current_album_name, 200, 65, 0.38f, CLR_DIM);
+    draw_line(&line_time, tt_s, 200, 120, 0.45f, CLR_WHITE);
+    C2D_DrawRectSolid(200, 145, 0.5f, 180, 12, CLR_CARD); C2D_DrawRectSolid(200, 145, 0.5f, v.bar_px, 12, CLR_ACCENT);
+    // Seek-to-audio latency, for a few seconds after each seek lands
+    if (v.seek_note) {
+        char sk[64]; snprintf(sk, sizeof(sk), "Seek: %lu ms (worst %lu)", (unsigned long)as.seek_ms, (unsigned long)as.seek_max_ms);
+        draw_line(&line_seek, sk, 200, 162, 0.35f, CLR_DIM);
+    }
+    if (v.searching) {
+        char st[128]; snprintf(st, sizeof(st), "Search: %s (%d%s)", search_text, v.list_count, search_remote ? " on server" : "");
+        draw_line(&line_search, st, 200, 200, 0.4f, CLR_ACCENT);
+    }
+    if (frame_stats) {
+        char fs[128]; snprintf(fs, sizeof(fs), "CPU %.2f ms/frame  drawn top %lu bottom %lu /s  %lu parses/s",
+            frame_last.frames ? frame_last.busy_ticks * 1000.0 / SYSCLOCK_ARM11 / frame_last.frames : 0.0,
+            (unsigned long)frame_last.top_draws, (unsigned long)frame_last.bottom_draws, (unsigned long)frame_last.parses);
+        draw_line(&line_stats, fs, 5, 225, 0.35f, CLR_DIM);
+    }
+}
+
+void draw_next_up_preview(int slot, int x, int y, int q_idx) {
     if (q_idx >= playback_queue.size()) return;
     int actual_idx = playback_queue[q_idx];
     C2D_DrawRectSolid(x, y, 0.4f, 130, 60, CLR_CARD);
-    if (has_album_art) C2D_DrawImageAt(album_art_image, x + 5, y + 5, 0.5f, NULL, 0.2f, 0.2f);
-    C2D_Text nextTxt; C2D_TextParse(&nextTxt, g_dynamicBuf, current_list[actual_idx].Name.c_str());
-    C2D_DrawText(&nextTxt, C2D_WithColor, x + 50, y + 15, 0.5f, 0.4f, 0.4f, CLR_WHITE);
+    char key[ITEM_ID_HEX]; art_key(actual_idx, key);
+    draw_album_art(key, x + 5, y + 5, 51);
+    draw_line(&line_next[slot], current_list.name(actual_idx), x + 50, y + 15, 0.4f, CLR_WHITE);
+}
+
+// Once a second: rates over the last second, for the overlay and the trace
+void sample_telemetry() {
+    u32 rx = stream_received();
+    telemetry.stream_kbps = (rx - stream_bytes_seen) / 1024; stream_bytes_seen = rx;
+    telemetry.heap_kb = mallinfo().uordblks / 1024;
+    telemetry.linear_free_kb = linearSpaceFree() / 1024;
+    u32 busy_us = 0, frames = 0;
+    for (int i = 0; i < 2; i++) {
+        DecoderStats d = decoder_get_stats(&streams[i].dec);
+        busy_us += d.busy_us - decode_seen[i].busy_us; frames += d.frames - decode_seen[i].frames;
+        decode_seen[i] = d;
+    }
+    telemetry.decode_pct = busy_us / 10000; telemetry.decode_speed_pct = frames * 100 / HARDWARE_RATE;
+    for (int k = 0; k < NET_KIND_COUNT; k++) {
+        NetStats n = net_get_stats((NetKind)k); NetStats& o = net_seen[k];
+        u32 reqs = n.requests - o.requests, conns = n.new_connections - o.new_connections;
+        telemetry.net_requests[k] = reqs;
+        telemetry.first_byte_ms[k] = reqs ? (u32)((n.first_byte_us - o.first_byte_us) / reqs / 1000) : 0;
+        telemetry.connect_ms[k] = conns ? (u32)((n.connect_us - o.connect_us) / conns / 1000) : 0;
+        o = n;
+    }
+    trace_counter(TRACE_STREAM_KBPS, TRACE_LANE_MAIN, telemetry.stream_kbps);
+    trace_counter(TRACE_HEAP_KB, TRACE_LANE_MAIN, telemetry.heap_kb);
+    trace_counter(TRACE_LINEAR_KB, TRACE_LANE_MAIN, telemetry.linear_free_kb);
+    trace_flush();
+}
+
+void draw_overlay(const AudioStats& as) {
+    C2D_DrawRectSolid(0, 76, 0.5f, 320, 164, C2D_Color32(0, 0, 0, 210));
+    char ln[10][96];
+    double ms_per_tick = 1000.0 / SYSCLOCK_ARM11;
+    snprintf(ln[0], sizeof(ln[0]), "CPU %.2f ms/frame, worst %.2f  drawn %lu/%lu /s",
+        frame_last.frames ? frame_last.busy_ticks * ms_per_tick / frame_last.frames : 0.0, frame_last.max_ticks * ms_per_tick,
+        (unsigned long)frame_last.top_draws, (unsigned long)frame_last.bottom_draws);
+    double ms_per_byte = 1000.0 / (HARDWARE_RATE * FRAME_BYTES);
+    snprintf(ln[1], sizeof(ln[1]), "DSP %lu/%d bufs  ring %.0f of %.0f ms  %lu kB/s", (unsigned long)as.dsp_queued, NUM_BUFFERS,
+        as.ring_fill * ms_per_byte, as.ring_size * ms_per_byte, (unsigned long)telemetry.stream_kbps);
+    snprintf(ln[2], sizeof(ln[2]), "Underruns %lu  rebuffers %lu  link %lu kbps  decode %lu%% at %lu%%",
+        (unsigned long)as.underruns, (unsigned long)as.rebuffers, (unsigned long)abr.rate_kbps,
+        (unsigned long)telemetry.decode_pct, (unsigned long)telemetry.decode_speed_pct);
+    for (int k = 0; k < NET_KIND_COUNT; k++)
+        snprintf(ln[3 + k], sizeof(ln[0]), "%-6s %lu req/s  connect %lu ms  first byte %lu ms", net_kind_names[k],
+            (unsigned long)telemetry.net_requests[k], (unsigned long)telemetry.connect_ms[k], (unsigned long)telemetry.first_byte_ms[k]);
+    ArtStats art = art_get_stats();
+    snprintf(ln[7], sizeof(ln[7]), "JPEG %.1f ms, avg %.1f, worst %.1f (%lu)", art.last_us / 1000.0,
+        art.decodes ? art.total_us / 1000.0 / art.decodes : 0.0, art.max_us / 1000.0, (unsigned long)art.decodes);
+    snprintf(ln[8], sizeof(ln[8]), "Heap %lu KB used  linear %lu KB free", (unsigned long)telemetry.heap_kb, (unsigned long)telemetry.linear_free_kb);
+    if (trace_enabled) snprintf(ln[9], sizeof(ln[9]), "Trace %lu records, %lu dropped", (unsigned long)trace_written(), (unsigned long)trace_dropped());
+    else snprintf(ln[9], sizeof(ln[9]), "Trace off (trace=1 in config.txt)");
+    for (int i = 0; i < 10; i++) draw_line(&line_overlay[i], ln[i], 6, 78 + i * 16, 0.4f, i == 2 && as.underruns ? CLR_ACCENT : CLR_WHITE);
+}
+
+// Frames and empty cells first, then every cover, all from the one atlas,
+// then the name: the covers go out as a single batch.
+void draw_album_grid(const BottomView& v) {
+    const C2D_Image* img[GRID_COLS * GRID_ROWS] = {};
+    for (int i = 0; i < GRID_COLS * GRID_ROWS; i++) {
+        int idx = v.grid_top * GRID_COLS + i;
+        if (idx >= v.count) break;
+        float x = GRID_LEFT + (i % GRID_COLS) * GRID_CELL, y = GRID_TOP + (i / GRID_COLS) * GRID_CELL;
+        if (idx == v.scroll) C2D_DrawRectSolid(x, y, 0.5f, THUMB_SIZE + 4, THUMB_SIZE + 4, CLR_ACCENT);
+        char key[ITEM_ID_HEX]; art_key(view_item(idx), key);
+        if (!(img[i] = thumb_get(key))) C2D_DrawRectSolid(x + 2, y + 2, 0.5f, THUMB_SIZE, THUMB_SIZE, CLR_CARD);
+    }
+    for (int i = 0; i < GRID_COLS * GRID_ROWS; i++) {
+        if (!img[i]) continue;
+        const Tex3DS_SubTexture* sub = img[i]->subtex;
+        float x = GRID_LEFT + (i % GRID_COLS) * GRID_CELL + 2 + (THUMB_SIZE - sub->width) / 2;
+        float y = GRID_TOP + (i / GRID_COLS) * GRID_CELL + 2 + (THUMB_SIZE - sub->height) / 2;
+        C2D_DrawImageAt(*img[i], x, y, 0.5f, NULL, 1.0f, 1.0f);
+    }
+    if (v.count) draw_line(&line_grid_name, current_list.name(view_item(v.scroll)), 6, 3, 0.5f, CLR_WHITE);
+}
+
+void draw_bottom(const BottomView& v, const AudioStats& as) {
+    C2D_TargetClear(bottom_target, CLR_BLACK);
+    C2D_SceneBegin(bottom_target);
+    if (current_state == STATE_PLAYER && sprite_sheet) {
+        // New design layout
+        C2D_DrawImageAt(C2D_SpriteSheetGetImage(sprite_sheet, icons_back_chevron_idx), 20, 20, 0.5f, NULL, 0.8f, 0.8f);
+        int li = (loop_mode == LOOP_ONE) ? icons_loop_one_idx : (loop_mode == LOOP_ALL ? icons_loop_all_idx : icons_loop_off_idx);
+        C2D_DrawImageAt(C2D_SpriteSheetGetImage(sprite_sheet, li), 270, 20, 0.5f, NULL, 0.8f, 0.8f);
+        C2D_DrawImageAt(C2D_SpriteSheetGetImage(sprite_sheet, is_shuffled ? icons_shuffle_on_idx : icons_shuffle_off_idx), 220, 20, 0.5f, NULL, 0.8f, 0.8f);
+
+        C2D_DrawImageAt(C2D_SpriteSheetGetImage(sprite_sheet, is_paused ? icons_paused_idx : icons_playing_idx), 160-35, 140-35, 0.5f, NULL, 0.5f, 0.5f);
+        C2D_DrawImageAt(C2D_SpriteSheetGetImage(sprite_sheet, icons_prev_sng_idx), 80, 140-25, 0.5f, NULL, 0.5f, 0.5f);
+        C2D_DrawImageAt(C2D_SpriteSheetGetImage(sprite_sheet, icons_next_sng_idx), 220, 140-25, 0.5f, NULL, 0.5f, 0.5f);
+
+        // Seek bar; drag along it to scrub
+        C2D_DrawRectSolid(20, 82, 0.5f, 280, 6, CLR_CARD); C2D_DrawRectSolid(20, 82, 0.5f, v.bar_px, 6, CLR_ACCENT);
+        C2D_DrawRectSolid(20 + v.bar_px - 3, 78, 0.5f, 6, 14, CLR_WHITE);
+
+        draw_line(&line_next_head, "Next Up:", 20, 180, 0.5f, CLR_WHITE);
+        draw_next_up_preview(0, 40, 200, queue_index + 1);
+        draw_next_up_preview(1, 180, 200, queue_index + 2);
+    } else if (current_state != STATE_PLAYER) {
+        if (v.grid_top >= 0) draw_album_grid(v);
+        else for (int i = 0; i < 10; i++) {
+            int idx = scroll_index - 4 + i;
+            if (idx < 0 || idx >= view_size()) continue;
+            int item = view_item(idx);
+            if (idx == scroll_index) C2D_DrawRectSolid(0, 15 + (i * 22), 0.4f, 320, 20, CLR_CARD);
+            draw_line(&line_rows[idx % 10], current_list.name(item), 15, 15 + (i * 22), 0.5f, (idx == scroll_index) ? CLR_ACCENT : CLR_DIM);
+            if (current_state == STATE_SONGS) {
+                char id[ITEM_ID_HEX]; item_id_format(current_list.ids[item], id);
+                CacheState cs = cache_item_state(id);
+                if (cs != CACHE_NONE) C2D_DrawRectSolid(286, 22 + (i * 22), 0.5f, 6, 6, cs == CACHE_PINNED ? CLR_ACCENT : CLR_DIM);
+            }
+        }
+        // Letter strip along the right edge, lit where the cursor is
+        if (v.count) {
+            int cur = index_list().buckets[view_item(scroll_index)];
+            C2D_DrawRectSolid(296, 0, 0.45f, 24, 240, CLR_BLACK);
+            for (int b = 0; b < SEARCH_BUCKETS; b++)
+                C2D_DrawText(&letter_text[b], C2D_WithColor, 304, b * 240.0f / SEARCH_BUCKETS, 0.5f, 0.35f, 0.35f, b == cur ? CLR_ACCENT : CLR_DIM);
+        }
+    }
+    if (v.overlay_gen) draw_overlay(as);
 }
 
 int main(int argc, char* argv[]) {
     gfxInitDefault(); C3D_Init(C3D_DEFAULT_CMDBUF_SIZE); C2D_Init(C2D_DEFAULT_MAX_OBJECTS); C2D_Prepare();
     top_target = C2D_CreateScreenTarget(GFX_TOP, GFX_LEFT); bottom_target = C2D_CreateScreenTarget(GFX_BOTTOM, GFX_LEFT);
-    g_dynamicBuf = C2D_TextBufNew(4096); ndspInit(); ptmuInit();
-    audio_ptr = (u8*)linearAlloc(AUDIO_BUF_SIZE * NUM_BUFFERS); 
-    json_buffer = (char*)malloc(MAX_JSON_SIZE); soc_buffer = (u32*)memalign(SOC_ALIGN, SOC_BUFFERSIZE);
+    ptmuInit();
+    letters_buf = C2D_TextBufNew(SEARCH_BUCKETS * 2);
+    for (int b = 0; b < SEARCH_BUCKETS; b++) { C2D_TextParse(&letter_text[b], letters_buf, search_bucket_label(b)); C2D_TextOptimize(&letter_text[b]); }
+    // Applets like HOME draw over both screens; repaint on the way back
+    aptHookCookie apt_cookie;
+    aptHook(&apt_cookie, [](APT_HookType t, void*) { if (t == APTHOOK_ONRESTORE || t == APTHOOK_ONWAKEUP) force_redraw = true; }, NULL);
+    soc_buffer = (u32*)memalign(SOC_ALIGN, SOC_BUFFERSIZE);
     if(soc_buffer) socInit(soc_buffer, SOC_BUFFERSIZE);
-    for(int i=0; i<NUM_BUFFERS; i++) waveBuf[i].data_vaddr = audio_ptr + (i * AUDIO_BUF_SIZE);
 
     sprite_sheet = C2D_SpriteSheetLoad(ICONS_PATH);
 
     mkdir(CONFIG_DIR, 0777);
-    FILE* cfg = fopen(CONFIG_PATH, "r");
-    if (!cfg) { if (perform_login()) { FILE* fw = fopen(CONFIG_PATH, "w"); fprintf(fw, "%s\n%s", server_url, access_token); fclose(fw); } }
-    else { fscanf(cfg, "%255s\n%255s", server_url, access_token); fclose(cfg); }
+    net_init();
+    if (!load_config() && perform_login()) save_config();
+    if (trace_on) trace_init(TRACE_PATH, TRACE_PREV_PATH);
+    net_set_token(access_token);
+    audio_init(); cache_init(); art_init(); thumbs_init();
 
-    fetch_items(std::string(server_url) + "/Items?IncludeItemTypes=MusicAlbum&Recursive=true&SortBy=SortName");
+    library_keep(&current_list); library_load(server_url); show_albums(NULL); library_sync();
 
+    TopView top_drawn; BottomView bottom_drawn;
+    u32 frame_count = 0;
     while (aptMainLoop()) {
+        u64 frame_t0 = svcGetSystemTick();
         hidScanInput(); u32 kDown = hidKeysDown(), kHeld = hidKeysHeld();
         touchPosition touch; hidTouchRead(&touch);
         if (kDown & KEY_START) break;
-        if (current_state == STATE_PLAYER && is_playing && !thread_run && !is_paused && has_album_art) next_track();
+        if (kDown & KEY_SELECT) {
+            if (abr_on) { abr_on = 0; session_codec = 0; }
+            else if (session_codec + 1 == CODEC_COUNT) abr_on = 1;
+            else session_codec++;
+        }
+        if (audio_take_switch()) on_track_switched();
+        if (current_state == STATE_PLAYER && is_playing && !is_paused && audio_drained()) next_track();
+        update_prefetch();
+        want_thumbs();
+        net_poll();
+        if (library_take_changed() && current_state == STATE_ALBUMS && !list_request && !search_remote) {
+            ItemId sel = view_size() ? current_list.ids[view_item(scroll_index)] : ItemId();
+            show_albums(&sel);
+        }
         if (kDown & KEY_B) { // Should work now
-            if (current_state == STATE_PLAYER) { stop_playback(); is_playing = false; current_state = STATE_SONGS; }
-            else if (current_state == STATE_SONGS) { fetch_items(std::string(server_url) + "/Items?IncludeItemTypes=MusicAlbum&Recursive=true&SortBy=SortName"); current_state = STATE_ALBUMS; scroll_index = 0; }
+            if (list_request && list_request_start == 0) { net_cancel(list_request); list_request = 0; if (search_remote) clear_search(); }
+            else if (current_state != STATE_PLAYER && search_text[0]) clear_search();
+            else if (current_state == STATE_PLAYER) { stop_playback(); is_playing = false; current_state = STATE_SONGS; }
+            else if (current_state == STATE_SONGS) show_albums(&list_album);
         }
 
         if (kHeld & KEY_Y) {
             y_hold_timer++;
             if (y_hold_timer >= 600) {
                 y_hold_timer = 0; stop_playback();
-                if (perform_login()) { FILE* fw = fopen(CONFIG_PATH, "w"); fprintf(fw, "%s\n%s", server_url, access_token); fclose(fw); fetch_items(std::string(server_url) + "/Items?IncludeItemTypes=MusicAlbum&Recursive=true&SortBy=SortName"); current_state = STATE_ALBUMS; scroll_index = 0; }
+                if (perform_login()) { save_config(); reset_search(); library_load(server_url); show_albums(NULL); library_sync(); }
             }
         } else y_hold_timer = 0;
+        if ((kHeld & KEY_Y) && (kDown & KEY_X)) { overlay_on = !overlay_on; y_hold_timer = 0; }
 
         if (current_state == STATE_PLAYER) {
+            // Scrubbing: L/R step 10 s and run on while held, the seek bar follows the stylus; seeks on release
+            double pos = audio_get_stats().position / (double)HARDWARE_RATE;
+            if (kDown & (KEY_L | KEY_R)) { scrub_sec = (scrubbing ? scrub_sec : pos) + (kDown & KEY_R ? 10 : -10); scrubbing = true; scrub_timer = 0; }
+            else if (kHeld & (KEY_L | KEY_R) && scrubbing && ++scrub_timer > 20) scrub_sec += (kHeld & KEY_R ? 1 : -1) * (scrub_timer > 80 ? 2.0 : 0.5);
+            if ((kDown & KEY_TOUCH) && touch.py >= 70 && touch.py < 100) scrubbing = true;
+            if ((kHeld & KEY_TOUCH) && scrubbing && !(kHeld & (KEY_L | KEY_R))) scrub_sec = (touch.px - 20) / 280.0 * current_duration_seconds;
+            if (scrubbing) {
+                if (scrub_sec < 0) scrub_sec = 0;
+                if (scrub_sec > current_duration_seconds) scrub_sec = current_duration_seconds;
+                if (!(kHeld & (KEY_L | KEY_R | KEY_TOUCH))) { seek_to(scrub_sec); scrubbing = false; }
+            }
             if (kDown & KEY_TOUCH) {
                 if (touch.px < 50 && touch.py < 50) { stop_playback(); is_playing = false; current_state = STATE_SONGS; }
-                if (touch.px > 260 && touch.py < 50) loop_mode = (LoopMode)((loop_mode + 1) % 3);
+                if (touch.px > 260 && touch.py < 50) { loop_mode = (LoopMode)((loop_mode + 1) % 3); invalidate_prefetch(); }
+                if (touch.px > 210 && touch.px <= 260 && touch.py < 50) toggle_shuffle();
                 
-                if (touch.px > 120 && touch.px < 200 && touch.py > 100 && touch.py < 180) { is_paused = !is_paused; ndspChnSetPaused(0, is_paused); }
+                if (touch.px > 120 && touch.px < 200 && touch.py > 100 && touch.py < 180) { is_paused = !is_paused; audio_set_paused(is_paused); }
                 
                 if (touch.py > 110 && touch.py < 170) { 
                     if (touch.px > 210) next_track();
@@ -359,58 +922,113 @@ int main(int argc, char* argv[]) {
                 }
             }
         } else {
-            bool up = (kDown & KEY_DUP), down = (kDown & KEY_DDOWN);
+            scrubbing = false;
+            bool grid = album_grid();
+            bool up = (kDown & KEY_DUP), down = (kDown & KEY_DDOWN), activate = kDown & KEY_A;
             if (kHeld & (KEY_DUP | KEY_DDOWN)) { repeat_timer++; if (repeat_timer >= 30 && (repeat_timer % 5 == 0)) { if (kHeld & KEY_DUP) up = true; if (kHeld & KEY_DDOWN) down = true; } } else repeat_timer = 0;
-            if (up) scroll_index--; if (down) scroll_index++;
-            if (!current_list.empty()) { if (scroll_index < 0) scroll_index = 0; if (scroll_index >= (int)current_list.size()) scroll_index = (int)current_list.size() - 1; }
-            if (kDown & KEY_A && !current_list.empty()) {
-                if (current_state == STATE_ALBUMS) { fetch_items(std::string(server_url) + "/Items?ParentId=" + current_list[scroll_index].Id); current_state = STATE_SONGS; }
-                else { build_queue(scroll_index); play_current_queue_item(); }
+            int step = grid ? GRID_COLS : 1;
+            if (up && scroll_index >= step) scroll_index -= step; if (down) scroll_index += step;
+            bool loading = list_request && list_request_start == 0;
+            if (!loading) {
+                // In the grid left/right step across a row; the letter strip still jumps
+                if (kDown & KEY_DRIGHT) { if (grid) scroll_index++; else jump_group(1); }
+                if (kDown & KEY_DLEFT) { if (grid) scroll_index--; else jump_group(-1); }
+                if ((kHeld & KEY_TOUCH) && touch.px >= 296) jump_to_bucket(touch.py * SEARCH_BUCKETS / 240); // letter strip; drag to scrub
+                // Tapping a cover selects it, tapping the selected one opens it
+                if (grid && (kDown & KEY_TOUCH) && touch.px >= GRID_LEFT && touch.px < GRID_LEFT + GRID_COLS * GRID_CELL && touch.py >= GRID_TOP) {
+                    int idx = (grid_top + (touch.py - GRID_TOP) / GRID_CELL) * GRID_COLS + (touch.px - GRID_LEFT) / GRID_CELL;
+                    if (idx == scroll_index) activate = true;
+                    else if (idx < view_size()) scroll_index = idx;
+                }
             }
+            if (scroll_index >= view_size()) scroll_index = view_size() - 1;
+            if (scroll_index < 0) scroll_index = 0;
+            if (grid) follow_grid();
+            fetch_more_items();
+            if (activate && view_size() && !loading) {
+                int item = view_item(scroll_index);
+                if (current_state == STATE_ALBUMS) { reset_search(); open_album(item); }
+                else { std::vector<int> items; for (int i = 0; i < view_size(); i++) items.push_back(view_item(i)); build_queue(items, item); play_current_queue_item(); }
+            }
+            if (kDown & KEY_L && !loading) open_search();
+            if (kDown & KEY_R && search_text[0]) clear_search();
+            if (kDown & KEY_X && !(kHeld & KEY_Y) && current_state == STATE_SONGS) toggle_album_pin();
         }
 
-        C3D_FrameBegin(C3D_FRAME_SYNCDRAW);
-        C2D_TextBufClear(g_dynamicBuf);
-        C2D_TargetClear(top_target, CLR_BLACK);
-        C2D_SceneBegin(top_target);
-        draw_status_bar();
-        if (has_album_art) C2D_DrawImageAt(album_art_image, 15, 30, 0.5f, NULL, 0.65f, 0.65f);
-        C2D_Text t, s, tm; C2D_TextParse(&t, g_dynamicBuf, current_song_name); C2D_TextParse(&s, g_dynamicBuf, current_album_name);
-        double el = (double)total_samples_played / 48000.0; char tt_s[64]; snprintf(tt_s, sizeof(tt_s), "%d:%02d/%d:%02d", (int)el/60, (int)el%60, (int)current_duration_seconds/60, (int)current_duration_seconds%60);
-        C2D_TextParse(&tm, g_dynamicBuf, tt_s);
-        C2D_DrawText(&t, C2D_WithColor, 200, 40, 0.5f, 0.65f, 0.65f, CLR_WHITE); C2D_DrawText(&s, C2D_WithColor, 200, 65, 0.5f, 0.38f, 0.38f, CLR_DIM);
-        C2D_DrawText(&tm, C2D_WithColor, 200, 120, 0.5f, 0.45f, 0.45f, CLR_WHITE);
+        // Polled once a second; both are IPC calls
+        if (frame_count++ % 60 == 0) {
+            u8 bat = 0; PTMU_GetBatteryLevel(&bat);
+            battery_level = bat > 6 ? 6 : bat; wifi_level = osGetWifiStrength();
+            abr_tick(audio_get_stats());
+            if (overlay_on || trace_enabled) { sample_telemetry(); overlay_gen++; }
+        }
+        AudioStats as = audio_get_stats();
+        double el = scrubbing ? scrub_sec : (double)as.position / HARDWARE_RATE;
         float pr = (current_duration_seconds > 0) ? (float)(el / current_duration_seconds) : 0;
-        C2D_DrawRectSolid(200, 145, 0.5f, 180, 12, CLR_CARD); C2D_DrawRectSolid(200, 145, 0.5f, 180 * (pr > 1.0f ? 1.0f : pr), 12, CLR_ACCENT);
-
-        C2D_TargetClear(bottom_target, CLR_BLACK);
-        C2D_SceneBegin(bottom_target);
-        if (current_state == STATE_PLAYER && sprite_sheet) {
-            // New design layout
-            C2D_DrawImageAt(C2D_SpriteSheetGetImage(sprite_sheet, icons_back_chevron_idx), 20, 20, 0.5f, NULL, 0.8f, 0.8f);
-            int li = (loop_mode == LOOP_ONE) ? icons_loop_one_idx : (loop_mode == LOOP_ALL ? icons_loop_all_idx : icons_loop_off_idx);
-            C2D_DrawImageAt(C2D_SpriteSheetGetImage(sprite_sheet, li), 270, 20, 0.5f, NULL, 0.8f, 0.8f);
-            
-            C2D_DrawImageAt(C2D_SpriteSheetGetImage(sprite_sheet, is_paused ? icons_paused_idx : icons_playing_idx), 160-35, 140-35, 0.5f, NULL, 0.5f, 0.5f);
-            C2D_DrawImageAt(C2D_SpriteSheetGetImage(sprite_sheet, icons_prev_sng_idx), 80, 140-25, 0.5f, NULL, 0.5f, 0.5f);
-            C2D_DrawImageAt(C2D_SpriteSheetGetImage(sprite_sheet, icons_next_sng_idx), 220, 140-25, 0.5f, NULL, 0.5f, 0.5f);
-
-            C2D_Text nxtHead; C2D_TextParse(&nxtHead, g_dynamicBuf, "Next Up:");
-            C2D_DrawText(&nxtHead, C2D_WithColor, 20, 180, 0.5f, 0.5f, 0.5f, CLR_WHITE);
-            draw_next_up_preview(40, 200, queue_index + 1);
-            draw_next_up_preview(180, 200, queue_index + 2);
-
-        } else if (current_state != STATE_PLAYER) {
-            for (int i = 0; i < 10; i++) {
-                int idx = scroll_index - 4 + i;
-                if (idx >= 0 && idx < (int)current_list.size()) {
-                    C2D_Text it; C2D_TextParse(&it, g_dynamicBuf, current_list[idx].Name.c_str());
-                    if (idx == scroll_index) C2D_DrawRectSolid(0, 15 + (i * 22), 0.4f, 320, 20, CLR_CARD);
-                    C2D_DrawText(&it, C2D_WithColor, 15, 15 + (i * 22), 0.5f, 0.5f, 0.5f, (idx == scroll_index) ? CLR_ACCENT : CLR_DIM);
-                }
+        if (pr > 1.0f) pr = 1.0f;
+        if (as.seeks != seeks_seen) { seeks_seen = as.seeks; seek_note_timer = 180; }
+        if (seek_note_timer > 0) seek_note_timer--;
+
+        TopView tv; memset(&tv, 0, sizeof(tv));
+        tv.art = art_get(now_playing_art); tv.track = track_gen; tv.codec = abr_on ? CODEC_COUNT + (stream_rung[cur_stream] >= 0 ? stream_rung[cur_stream] : abr_rung) : session_codec;
+        tv.wifi = wifi_level; tv.battery = battery_level; tv.seeks = as.seeks; tv.stats_gen = frame_stats_gen;
+        tv.elapsed_s = (int)el; tv.bar_px = (int)(180 * pr);
+        tv.loading = list_request || (library_syncing() && library_albums.empty());
+        tv.buffering = is_playing && as.buffering; tv.seek_note = seek_note_timer > 0;
+        tv.searching = current_state != STATE_PLAYER && search_text[0];
+        if (tv.searching) { tv.list_gen = list_gen; tv.list_count = search_remote ? list_total : view_size(); }
+
+        BottomView bv; memset(&bv, 0, sizeof(bv));
+        bv.state = current_state;
+        if (current_state == STATE_PLAYER) {
+            for (int i = 0; i < 2; i++) if (queue_index + 1 + i < (int)playback_queue.size()) {
+                char key[ITEM_ID_HEX]; art_key(playback_queue[queue_index + 1 + i], key); bv.next_art[i] = art_get(key);
             }
+            bv.queue_gen = queue_gen; bv.queue_pos = queue_index; bv.bar_px = (int)(280 * pr);
+            bv.paused = is_paused; bv.shuffled = is_shuffled; bv.loop = loop_mode;
+        } else {
+            bv.list_gen = list_gen; bv.scroll = scroll_index; bv.count = view_size();
+            if (current_state == STATE_SONGS) bv.cache_gen = cache_generation();
         }
+        bv.grid_top = album_grid() ? grid_top : -1;
+        if (bv.grid_top >= 0) {
+            for (int i = 0; i < GRID_COLS * GRID_ROWS && (grid_top * GRID_COLS + i) < bv.count; i++) {
+                char key[ITEM_ID_HEX]; art_key(view_item(grid_top * GRID_COLS + i), key);
+                if (thumb_get(key)) bv.thumbs_shown |= 1u << i;
+            }
+        }
+        if (overlay_on) bv.overlay_gen = overlay_gen + 1;
+
+        bool always = force_redraw || frame_stats == 2;
+        bool draw_top_screen = always || memcmp(&tv, &top_drawn, sizeof(tv));
+        bool draw_bottom_screen = always || memcmp(&bv, &bottom_drawn, sizeof(bv));
+        force_redraw = false;
+
+        u64 frame_t1 = svcGetSystemTick();
+        C3D_FrameBegin(C3D_FRAME_SYNCDRAW);
+        u64 frame_t2 = svcGetSystemTick();
+        art_collect(); thumbs_collect();
+        if (draw_top_screen) { draw_top(tv, as); memcpy(&top_drawn, &tv, sizeof(tv)); frame_acc.top_draws++; }
+        if (draw_bottom_screen) { draw_bottom(bv, as); memcpy(&bottom_drawn, &bv, sizeof(bv)); frame_acc.bottom_draws++; }
         C3D_FrameEnd(0);
+        u64 frame_t3 = svcGetSystemTick();
+        trace_span(TRACE_UPDATE, TRACE_LANE_MAIN, frame_t0, frame_t1);
+        trace_span(TRACE_DRAW, TRACE_LANE_MAIN, frame_t2, frame_t3, (draw_top_screen ? 1 : 0) | (draw_bottom_screen ? 2 : 0));
+
+        u64 busy = (frame_t1 - frame_t0) + (frame_t3 - frame_t2);
+        frame_acc.busy_ticks += busy;
+        if (busy > frame_acc.max_ticks) frame_acc.max_ticks = busy;
+        if (++frame_acc.frames == 60) {
+            frame_acc.parses = text_parses; text_parses = 0;
+            frame_last = frame_acc; memset(&frame_acc, 0, sizeof(frame_acc));
+            if (frame_stats) frame_stats_gen++;
+        }
     }
-    ptmuExit(); ndspExit(); linearFree(audio_ptr); free(json_buffer); free(soc_buffer); socExit(); gfxExit(); return 0;
+    TextLine* lines[] = { &line_codec, &line_loading, &line_song, &line_album, &line_time, &line_seek, &line_search, &line_stats, &line_next_head, &line_next[0], &line_next[1], &line_grid_name };
+    for (TextLine* l : lines) text_line_free(l);
+    for (TextLine& l : line_rows) text_line_free(&l);
+    for (TextLine& l : line_overlay) text_line_free(&l);
+    C2D_TextBufDelete(letters_buf);
+    aptUnhook(&apt_cookie);
+    stop_playback(); stream_free(&streams[0]); stream_free(&streams[1]); thumbs_exit(); art_exit(); cache_exit(); library_save(); net_exit(); ptmuExit(); audio_exit(); trace_exit(); free(soc_buffer); socExit(); gfxExit(); return 0;
 }
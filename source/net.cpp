@@ -0,0 +1,242 @@
+#include "net.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+struct NetJob { u32 id; std::string url, post; NetSink sink; NetDone done; void* user; };
+struct NetFinished { NetResult r; NetDone done; };
+struct Body { char* data; size_t len, cap; };
+struct SinkCtx { NetSink sink; void* user; };
+
+const char* const net_kind_names[] = { "api", "art", "stream", "pin" };
+
+static CURLSH* share = NULL;
+static LightLock share_locks[CURL_LOCK_DATA_LAST];
+static LightLock lock; // jobs, finished, token
+static LightLock stats_lock;
+static LightEvent job_event;
+static std::vector<NetJob> jobs;
+static std::vector<NetFinished> finished;
+static NetStats stats[NET_KIND_COUNT];
+static char token[256];
+static u32 next_id = 1;
+
+static Thread worker = NULL;
+static volatile bool worker_run = false;
+static volatile u32 running_id = 0;
+static volatile bool running_ok = false; // cleared to cancel the job in flight
+
+static void share_lock(CURL*, curl_lock_data data, curl_lock_access, void*) { LightLock_Lock(&share_locks[data]); }
+static void share_unlock(CURL*, curl_lock_data data, void*) { LightLock_Unlock(&share_locks[data]); }
+
+static int progress(void* p, curl_off_t, curl_off_t, curl_off_t, curl_off_t) { return *(volatile bool*)p ? 0 : 1; }
+
+void net_setup(CURL* c, volatile bool* run) {
+    curl_easy_setopt(c, CURLOPT_SHARE, share);
+    curl_easy_setopt(c, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(c, CURLOPT_TCP_KEEPALIVE, 1L);
+    if (run) {
+        curl_easy_setopt(c, CURLOPT_NOPROGRESS, 0L);
+        curl_easy_setopt(c, CURLOPT_XFERINFOFUNCTION, progress);
+        curl_easy_setopt(c, CURLOPT_XFERINFODATA, (void*)run);
+    }
+}
+
+CURLcode net_perform(CURL* c, NetKind kind, long* status) {
+    u64 t0 = svcGetSystemTick();
+    CURLcode res = curl_easy_perform(c);
+    u64 t1 = svcGetSystemTick();
+    long code = 0, conns = 0; curl_off_t bytes = 0, total = 0, first = 0, connect = 0;
+    curl_easy_getinfo(c, CURLINFO_RESPONSE_CODE, &code);
+    curl_easy_getinfo(c, CURLINFO_NUM_CONNECTS, &conns);
+    curl_easy_getinfo(c, CURLINFO_SIZE_DOWNLOAD_T, &bytes);
+    curl_easy_getinfo(c, CURLINFO_TOTAL_TIME_T, &total);
+    curl_easy_getinfo(c, CURLINFO_STARTTRANSFER_TIME_T, &first);
+    curl_easy_getinfo(c, CURLINFO_CONNECT_TIME_T, &connect);
+    if (status) *status = code;
+
+    TraceLane lane = (TraceLane)(TRACE_LANE_API + kind);
+    trace_span(TRACE_NET, lane, t0, t1, (u16)code);
+    if (conns) trace_span(TRACE_CONNECT, lane, t0, t0 + (u64)connect * SYSCLOCK_ARM11 / 1000000);
+    if (first) trace_span(TRACE_FIRST_BYTE, lane, t0, t0 + (u64)first * SYSCLOCK_ARM11 / 1000000);
+
+    LightLock_Lock(&stats_lock);
+    NetStats& s = stats[kind];
+    s.requests++;
+    if (res == CURLE_ABORTED_BY_CALLBACK) s.cancelled++;
+    else if (res != CURLE_OK || code >= 400) s.failures++;
+    s.new_connections += conns;
+    s.bytes += bytes; s.total_us += total; s.first_byte_us += first;
+    if (conns) s.connect_us += connect;
+    LightLock_Unlock(&stats_lock);
+    return res;
+}
+
+// --- API requests ---
+static size_t body_write(void* p, size_t sz, size_t n, void* u) {
+    Body* b = (Body*)u; size_t t = sz * n;
+    if (b->len + t + 1 > NET_MAX_BODY) return 0;
+    if (b->len + t + 1 > b->cap) {
+        size_t cap = b->cap ? b->cap * 2 : 16 * 1024;
+        while (cap < b->len + t + 1) cap *= 2;
+        char* grown = (char*)realloc(b->data, cap);
+        if (!grown) return 0;
+        b->data = grown; b->cap = cap;
+    }
+    memcpy(b->data + b->len, p, t); b->len += t; b->data[b->len] = '\0';
+    return t;
+}
+
+static size_t sink_write(void* p, size_t sz, size_t n, void* u) {
+    SinkCtx* s = (SinkCtx*)u;
+    return s->sink(p, sz * n, s->user) ? sz * n : 0;
+}
+
+// Runs one API request on c, which may carry a pooled connection from the last one
+static void run_request(CURL* c, const char* url, const char* post, const SinkCtx* sink, volatile bool* run, NetResult* out) {
+    char auth[384];
+    LightLock_Lock(&lock);
+    snprintf(auth, sizeof(auth), "X-Emby-Authorization: MediaBrowser Client=\"JellyCTR\", Device=\"3DS\", Version=\"0.2\"%s%s%s", token[0] ? ", Token=\"" : "", token, token[0] ? "\"" : "");
+    LightLock_Unlock(&lock);
+    struct curl_slist* h = curl_slist_append(NULL, auth);
+    if (post) h = curl_slist_append(h, "Content-Type: application/json");
+
+    Body b = { NULL, 0, 0 };
+    curl_easy_reset(c);
+    net_setup(c, run);
+    curl_easy_setopt(c, CURLOPT_URL, url);
+    curl_easy_setopt(c, CURLOPT_HTTPHEADER, h);
+    if (post) curl_easy_setopt(c, CURLOPT_POSTFIELDS, post);
+    curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, sink ? sink_write : body_write);
+    curl_easy_setopt(c, CURLOPT_WRITEDATA, sink ? (void*)sink : (void*)&b);
+    out->res = net_perform(c, NET_API, &out->status);
+    curl_slist_free_all(h);
+    if (!b.data && !sink) b.data = (char*)calloc(1, 1);
+    out->body = b.data; out->len = b.len;
+}
+
+static NetFinished make_finished(const NetJob& job) {
+    NetFinished f; memset(&f.r, 0, sizeof(f.r));
+    f.done = job.done; f.r.id = job.id; f.r.user = job.user;
+    return f;
+}
+
+static void net_worker(void*) {
+    CURL* c = curl_easy_init();
+    while (worker_run) {
+        LightLock_Lock(&lock);
+        bool have = !jobs.empty();
+        NetJob job; if (have) { job = jobs.front(); jobs.erase(jobs.begin()); running_id = job.id; running_ok = true; }
+        LightLock_Unlock(&lock);
+        if (!have) { LightEvent_WaitTimeout(&job_event, 500000000LL); continue; }
+
+        NetFinished f = make_finished(job);
+        SinkCtx sink = { job.sink, job.user };
+        run_request(c, job.url.c_str(), job.post.empty() ? NULL : job.post.c_str(), job.sink ? &sink : NULL, &running_ok, &f.r);
+
+        LightLock_Lock(&lock);
+        f.r.cancelled = !running_ok;
+        finished.push_back(f);
+        running_id = 0;
+        LightLock_Unlock(&lock);
+    }
+    curl_easy_cleanup(c);
+}
+
+void net_init() {
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) LightLock_Init(&share_locks[i]);
+    LightLock_Init(&lock); LightLock_Init(&stats_lock);
+    LightEvent_Init(&job_event, RESET_ONESHOT);
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    share = curl_share_init();
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, share_lock);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+    // Connections stay per handle: libcurl can't hand one connection pool to concurrent threads
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    s32 prio = 0x30; svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+    worker_run = true;
+    worker = threadCreate(net_worker, NULL, 64 * 1024, prio + 1, -2, false);
+}
+
+// Every other user of the share must be gone by now
+void net_exit() {
+    if (worker) { worker_run = false; running_ok = false; LightEvent_Signal(&job_event); threadJoin(worker, U64_MAX); threadFree(worker); worker = NULL; }
+    for (NetJob& j : jobs) { NetFinished f = make_finished(j); f.r.cancelled = true; finished.push_back(f); }
+    jobs.clear();
+    for (NetFinished& f : finished) f.r.cancelled = true;
+    net_poll(); // owners still get to free their user data
+    if (share) { curl_share_cleanup(share); share = NULL; }
+    curl_global_cleanup();
+}
+
+void net_set_token(const char* t) {
+    LightLock_Lock(&lock);
+    strncpy(token, t, sizeof(token) - 1); token[sizeof(token) - 1] = '\0';
+    LightLock_Unlock(&lock);
+}
+
+static u32 submit(NetJob& j) {
+    LightLock_Lock(&lock);
+    j.id = next_id++; if (!next_id) next_id = 1;
+    jobs.push_back(j);
+    LightLock_Unlock(&lock);
+    LightEvent_Signal(&job_event);
+    return j.id;
+}
+
+u32 net_submit(const char* url, const char* post, NetDone done, void* user) {
+    NetJob j; j.url = url; j.post = post ? post : ""; j.sink = NULL; j.done = done; j.user = user;
+    return submit(j);
+}
+
+u32 net_submit_sink(const char* url, NetSink sink, NetDone done, void* user) {
+    NetJob j; j.url = url; j.sink = sink; j.done = done; j.user = user;
+    return submit(j);
+}
+
+void net_cancel(u32 id) {
+    if (!id) return;
+    bool dropped = false;
+    LightLock_Lock(&lock);
+    for (size_t i = 0; i < jobs.size(); i++) if (jobs[i].id == id) {
+        NetFinished f = make_finished(jobs[i]);
+        f.r.res = CURLE_ABORTED_BY_CALLBACK; f.r.cancelled = true;
+        finished.push_back(f);
+        jobs.erase(jobs.begin() + i); dropped = true; break;
+    }
+    if (running_id == id) running_ok = false;
+    for (NetFinished& f : finished) if (f.r.id == id && !f.r.cancelled) { f.r.cancelled = true; dropped = true; }
+    LightLock_Unlock(&lock);
+    if (dropped) { LightLock_Lock(&stats_lock); stats[NET_API].cancelled++; LightLock_Unlock(&stats_lock); }
+}
+
+void net_poll() {
+    for (;;) {
+        LightLock_Lock(&lock);
+        bool have = !finished.empty();
+        NetFinished f; if (have) { f = finished.front(); finished.erase(finished.begin()); }
+        LightLock_Unlock(&lock);
+        if (!have) return;
+        if (f.done) f.done(&f.r);
+        free(f.r.body);
+    }
+}
+
+bool net_fetch(const char* url, const char* post, NetResult* out) {
+    memset(out, 0, sizeof(*out));
+    CURL* c = curl_easy_init();
+    if (!c) return false;
+    run_request(c, url, post, NULL, NULL, out);
+    curl_easy_cleanup(c);
+    return out->res == CURLE_OK && out->status < 400;
+}
+
+NetStats net_get_stats(NetKind kind) {
+    LightLock_Lock(&stats_lock);
+    NetStats s = stats[kind];
+    LightLock_Unlock(&stats_lock);
+    return s;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <3ds.h>
+#include <curl/curl.h>
+
+// --- Networking ---
+// Every handle shares one DNS and TLS session cache. API requests run on a
+// worker that keeps its connection warm, and their completions are handed
+// back to the main loop by net_poll(). Long transfers (streams, art, pins)
+// keep their own threads but set their handles up with net_setup().
+#define NET_MAX_BODY (2 * 1024 * 1024)
+
+enum NetKind { NET_API, NET_ART, NET_STREAM, NET_PIN, NET_KIND_COUNT };
+extern const char* const net_kind_names[];
+
+struct NetStats {
+    u32 requests, failures, cancelled;
+    u32 new_connections; // requests that had to open a connection
+    u64 bytes;
+    u64 total_us, first_byte_us; // summed, divide by requests
+    u64 connect_us;              // summed, divide by new_connections
+};
+
+struct NetResult {
+    u32 id;
+    CURLcode res;
+    long status;
+    bool cancelled;
+    char* body; // NUL-terminated, NULL for sink requests; freed once the callback returns
+    size_t len;
+    void* user;
+};
+typedef void (*NetDone)(const NetResult* r);
+typedef bool (*NetSink)(const void* data, size_t len, void* user); // worker thread; false aborts
+
+void net_init();
+void net_exit();
+void net_set_token(const char* token); // sent with every API request
+
+void net_setup(CURL* c, volatile bool* run);            // shared caches; the transfer aborts once *run goes false
+CURLcode net_perform(CURL* c, NetKind kind, long* status); // curl_easy_perform plus stats
+
+// done runs exactly once per request, from net_poll(), even when cancelled,
+// so it can always free user.
+u32 net_submit(const char* url, const char* post, NetDone done, void* user); // post may be NULL
+u32 net_submit_sink(const char* url, NetSink sink, NetDone done, void* user);  // body goes to sink, not kept
+void net_cancel(u32 id);
+void net_poll();         // runs completion callbacks, main thread
+bool net_fetch(const char* url, const char* post, NetResult* out); // blocking; caller frees out->body
+
+NetStats net_get_stats(NetKind kind);
@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+
+// Single-producer/single-consumer byte ring. head/tail are running byte totals
+// (they only ever grow), so fill = head - tail and no slot is wasted.
+// The producer owns head, the consumer owns tail; nothing here takes a lock.
+struct PcmRing {
+    uint8_t* data = NULL;
+    size_t size = 0;
+    std::atomic<size_t> head{0}, tail{0};
+    std::atomic<bool> eof{false};
+
+    bool init(size_t bytes) {
+        release();
+        data = (uint8_t*)malloc(bytes);
+        if (!data) return false;
+        size = bytes; reset();
+        return true;
+    }
+    void release() { free(data); data = NULL; size = 0; }
+    // Only safe while neither side is running.
+    void reset() { head.store(0); tail.store(0); eof.store(false); }
+
+    size_t fill() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+    size_t space() const { return size - fill(); }
+
+    // Producer side: copies as much as fits, returns bytes taken.
+    size_t write(const void* src, size_t len) {
+        size_t h = head.load(std::memory_order_relaxed), t = tail.load(std::memory_order_acquire);
+        size_t n = size - (h - t); if (len < n) n = len;
+        if (!n) return 0;
+        size_t off = h % size, first = size - off; if (first > n) first = n;
+        memcpy(data + off, src, first);
+        memcpy(data, (const uint8_t*)src + first, n - first);
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer side: copies up to len bytes out, returns bytes read.
+    size_t read(void* dst, size_t len) {
+        size_t t = tail.load(std::memory_order_relaxed), h = head.load(std::memory_order_acquire);
+        size_t n = h - t; if (len < n) n = len;
+        if (!n) return 0;
+        size_t off = t % size, first = size - off; if (first > n) first = n;
+        memcpy(dst, data + off, first);
+        memcpy((uint8_t*)dst + first, data, n - first);
+        tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer side: drops up to len bytes unread, returns bytes dropped.
+    size_t skip(size_t len) {
+        size_t t = tail.load(std::memory_order_relaxed), h = head.load(std::memory_order_acquire);
+        size_t n = h - t; if (len < n) n = len;
+        tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+};
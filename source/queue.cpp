@@ -0,0 +1,17 @@
+#include "queue.h"
+#include <algorithm>
+#include <random>
+
+void queue_build(std::vector<int>& queue, const std::vector<int>& items, int start_item, bool shuffle) {
+    queue = items;
+    if (shuffle) {
+        static std::mt19937 g(std::random_device{}());
+        std::shuffle(queue.begin(), queue.end(), g);
+        for (int i = 0; i < (int)queue.size(); i++) {
+            if (queue[i] == start_item) { std::swap(queue[0], queue[i]); break; }
+        }
+    } else {
+        std::sort(queue.begin(), queue.end());
+        std::rotate(queue.begin(), std::find(queue.begin(), queue.end(), start_item), queue.end());
+    }
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <vector>
+
+// --- Play queue ---
+// The queue holds list indices. Platform-free so tools/ can build it on the host.
+
+// Queue order for items with start_item first: list order from there on,
+// wrapping round, or shuffled.
+void queue_build(std::vector<int>& queue, const std::vector<int>& items, int start_item, bool shuffle);
@@ -0,0 +1,134 @@
+#include "search.h"
+#include <algorithm>
+
+// --- Folding ---
+// Base letters for U+00C0..U+00FF and U+0100..U+017F; '*' has a two-letter
+// spelling in fold_multi(), ' ' is a word break (the multiplication and
+// division signs)
+static const char latin1[] = "aaaaaa*ceeeeiiiidnooooo ouuuuy**" "aaaaaa*ceeeeiiiidnooooo ouuuuy*y";
+static const char latin_ext[] =
+    "aaaaaaccccccccddddeeeeeeeeeegggggggghhhhiiiiiiiiii**jjkkkllllllllllnnnnnnnnnoooooo**rrrrrrssssssssttttttuuuuuuuuuuuuwwyyyzzzzzzs";
+
+static const char* fold_multi(uint32_t c) {
+    switch (c) {
+    case 0xC6: case 0xE6: return "ae";
+    case 0xDE: case 0xFE: return "th";
+    case 0xDF: return "ss";
+    case 0x132: case 0x133: return "ij";
+    case 0x152: case 0x153: return "oe";
+    }
+    return NULL;
+}
+
+static void put_space(std::string& out) { if (!out.empty() && out[out.size() - 1] != ' ') out += ' '; }
+
+void search_fold(const char* s, std::string& out) {
+    out.clear();
+    const uint8_t* p = (const uint8_t*)s;
+    while (*p) {
+        uint32_t c = *p; int n = 1;
+        if (c >= 0xF0) { c &= 7; n = 4; }
+        else if (c >= 0xE0) { c &= 15; n = 3; }
+        else if (c >= 0xC0) { c &= 31; n = 2; }
+        else if (c >= 0x80) { p++; continue; } // stray continuation byte
+        int k = 1;
+        for (; k < n && (p[k] & 0xC0) == 0x80; k++) c = (c << 6) | (p[k] & 63);
+        if (k < n) { p += k; continue; } // truncated sequence
+        const uint8_t* at = p; p += n;
+        if (c < 0x80) {
+            if (c >= 'A' && c <= 'Z') out += (char)(c + 32);
+            else if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) out += (char)c;
+            else if (c != '\'') put_space(out); // "Don't" is one word
+            continue;
+        }
+        if (c == 0x2019) continue; // typographic apostrophe
+        const char* m = fold_multi(c);
+        char b = c >= 0xC0 && c < 0x100 ? latin1[c - 0xC0] : c >= 0x100 && c < 0x180 ? latin_ext[c - 0x100] : 0;
+        if (m) out += m;
+        else if (b == ' ' || c < 0xC0 || (c >= 0x2000 && c < 0x2070)) put_space(out); // Latin-1 and general punctuation
+        else if (b) out += b;
+        else out.append((const char*)at, n); // other scripts match as written
+    }
+    if (!out.empty() && out[out.size() - 1] == ' ') out.erase(out.size() - 1);
+}
+
+// Jellyfin's SortName drops leading articles, so bucket "The Cure" under C
+static int initial_bucket(const char* k) {
+    static const char* const articles[] = { "the ", "a ", "an " };
+    for (const char* a : articles) if (!strncmp(k, a, strlen(a)) && k[strlen(a)]) { k += strlen(a); break; }
+    return *k >= 'a' && *k <= 'z' ? *k - 'a' + 1 : 0;
+}
+
+const char* search_bucket_label(int b) {
+    static const char* const labels[SEARCH_BUCKETS] = { "#", "A", "B", "C", "D", "E", "F", "G", "H", "I", "J", "K", "L", "M",
+                                                        "N", "O", "P", "Q", "R", "S", "T", "U", "V", "W", "X", "Y", "Z" };
+    return labels[b];
+}
+
+// --- Index ---
+void SearchIndex::build(const ItemList& list) {
+    keys.clear(); key_at.clear(); words.clear(); buckets.clear();
+    for (int b = 0; b < SEARCH_BUCKETS; b++) first[b] = -1;
+    std::string k;
+    for (size_t i = 0; i < list.size(); i++) {
+        search_fold(list.name(i), k);
+        uint32_t off = keys.size();
+        key_at.push_back(off);
+        keys.insert(keys.end(), k.c_str(), k.c_str() + k.size() + 1);
+        for (size_t j = 0; j < k.size(); j++) if (j == 0 || k[j - 1] == ' ') words.push_back(off + j);
+        int b = initial_bucket(k.c_str());
+        buckets.push_back(b);
+        if (first[b] < 0) first[b] = i;
+    }
+    const char* base = keys.data();
+    std::sort(words.begin(), words.end(), [base](uint32_t a, uint32_t b) { return strcmp(base + a, base + b) < 0; });
+}
+
+// --- Queries ---
+static bool has_word_prefix(const char* key, const std::string& w) {
+    for (const char* p = key; p; p = strchr(p, ' ')) {
+        if (*p == ' ') p++;
+        if (!strncmp(p, w.c_str(), w.size())) return true;
+    }
+    return false;
+}
+
+static int item_of(const SearchIndex& ix, uint32_t off) {
+    return (int)(std::upper_bound(ix.key_at.begin(), ix.key_at.end(), off) - ix.key_at.begin()) - 1;
+}
+
+void search_match(const SearchIndex& ix, const char* query, std::vector<int>& out, const std::vector<int>* within) {
+    out.clear();
+    std::string q; search_fold(query, q);
+    if (q.empty()) return;
+    std::vector<std::string> ws;
+    for (size_t i = 0, j; i < q.size(); i = j + 1) {
+        j = q.find(' ', i); if (j == std::string::npos) j = q.size();
+        ws.push_back(q.substr(i, j - i));
+    }
+
+    // Candidates are the items holding the longest word, the rarest one as a rule
+    std::vector<int> cand;
+    if (within) cand = *within;
+    else {
+        const std::string* lw = &ws[0];
+        for (const std::string& w : ws) if (w.size() > lw->size()) lw = &w;
+        const char* base = ix.keys.data(); const char* w = lw->c_str(); size_t n = lw->size();
+        std::vector<uint32_t>::const_iterator lo = std::lower_bound(ix.words.begin(), ix.words.end(), w,
+            [base, n](uint32_t off, const char* w) { return strncmp(base + off, w, n) < 0; });
+        std::vector<uint32_t>::const_iterator hi = std::upper_bound(lo, ix.words.end(), w,
+            [base, n](const char* w, uint32_t off) { return strncmp(w, base + off, n) < 0; });
+        for (; lo != hi; ++lo) cand.push_back(item_of(ix, *lo));
+        std::sort(cand.begin(), cand.end());
+        cand.erase(std::unique(cand.begin(), cand.end()), cand.end());
+    }
+    for (int i : cand) {
+        bool all = true;
+        for (const std::string& w : ws) if (!has_word_prefix(ix.key(i), w)) { all = false; break; }
+        if (all) out.push_back(i);
+    }
+    if (!out.empty()) return;
+
+    // Mid-word matches are a plain scan; only reached when no word starts with the query
+    for (size_t i = 0; i < ix.size(); i++) if (strstr(ix.key(i), q.c_str())) out.push_back(i);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "store.h"
+
+// --- Search index ---
+// Names are folded to lowercase ASCII with Latin diacritics stripped
+// ("Björk" -> "bjork") and punctuation turned into word breaks. The index
+// keeps those keys, where each first letter starts, and every word start
+// sorted by the text that follows it, so a prefix of any word is a binary
+// search. Platform-free so tools/ can build it on the host.
+#define SEARCH_BUCKETS 27 // 0 is '#' (digits and the rest), then a-z
+
+struct SearchIndex {
+    std::vector<char> keys;       // folded names, NUL-terminated back to back
+    std::vector<uint32_t> key_at; // per item offset into keys
+    std::vector<uint32_t> words;  // offsets of word starts, sorted by what follows
+    std::vector<uint8_t> buckets; // per item, by the name with "the"/"a"/"an" skipped like SortName
+    int first[SEARCH_BUCKETS];    // first item in each bucket, -1 if none
+
+    void build(const ItemList& list);
+    size_t size() const { return key_at.size(); }
+    const char* key(size_t i) const { return keys.data() + key_at[i]; }
+    size_t bytes() const { return keys.capacity() + (key_at.capacity() + words.capacity()) * sizeof(uint32_t) + buckets.capacity(); }
+};
+
+void search_fold(const char* s, std::string& out);
+const char* search_bucket_label(int b); // "#", "A".."Z"
+
+// Items, in list order, where every query word starts a word of the name, or
+// failing that, whose name contains the query. within, if given, is the result
+// of a shorter query this one extends; it only has to be narrowed then.
+void search_match(const SearchIndex& ix, const char* query, std::vector<int>& out, const std::vector<int>* within = NULL);
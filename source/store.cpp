@@ -0,0 +1,141 @@
+#include "store.h"
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool item_id_parse(ItemId* out, const char* s) {
+    int n = 0;
+    for (; *s && n < 32; s++) {
+        if (*s == '-') continue;
+        int d = hex_digit(*s);
+        if (d < 0) return false;
+        if (n & 1) out->b[n >> 1] |= d; else out->b[n >> 1] = d << 4;
+        n++;
+    }
+    return n == 32 && !*s;
+}
+
+void item_id_format(const ItemId& id, char* out) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < 16; i++) { out[i * 2] = digits[id.b[i] >> 4]; out[i * 2 + 1] = digits[id.b[i] & 15]; }
+    out[32] = '\0';
+}
+
+// --- Arena ---
+static uint32_t fnv1a(const char* s) {
+    uint32_t h = 2166136261u;
+    while (*s) { h ^= (uint8_t)*s++; h *= 16777619u; }
+    return h;
+}
+
+static void slot_insert(std::vector<uint32_t>& slots, const StringArena& a, uint32_t off) {
+    size_t mask = slots.size() - 1, i = fnv1a(a.at(off)) & mask;
+    while (slots[i]) i = (i + 1) & mask;
+    slots[i] = off + 1;
+}
+
+static void grow_slots(StringArena& a, size_t want) {
+    size_t n = 64; while (n < want * 2) n <<= 1; // keep the load under half
+    if (n <= a.slots.size()) return;
+    std::vector<uint32_t> slots(n, 0);
+    for (uint32_t s : a.slots) if (s) slot_insert(slots, a, s - 1);
+    a.slots.swap(slots);
+}
+
+uint32_t StringArena::intern(const char* s) {
+    if (!s || !*s) return 0;
+    if (data.empty()) data.push_back('\0');
+    grow_slots(*this, count + 1);
+    size_t mask = slots.size() - 1, i = fnv1a(s) & mask;
+    for (; slots[i]; i = (i + 1) & mask) if (!strcmp(at(slots[i] - 1), s)) return slots[i] - 1;
+    uint32_t off = data.size();
+    data.insert(data.end(), s, s + strlen(s) + 1);
+    slots[i] = off + 1; count++;
+    return off;
+}
+
+void StringArena::clear() {
+    data.clear(); slots.clear(); count = 0;
+}
+
+bool StringArena::rebuild() {
+    slots.clear(); count = 0;
+    if (data.empty()) return true;
+    if (data[0] != '\0' || data.back() != '\0') return false;
+    size_t strings = 0;
+    for (char c : data) strings += !c;
+    grow_slots(*this, strings);
+    for (size_t off = 1; off < data.size(); off += strlen(at(off)) + 1) { slot_insert(slots, *this, off); count++; }
+    return true;
+}
+
+// --- Lists ---
+void ItemList::clear() {
+    ids.clear(); parents.clear(); names.clear(); albums.clear(); duration_ms.clear();
+}
+
+void ItemList::push(const ItemId& id, const char* name, const char* album, const ItemId& parent, uint32_t ms) {
+    ids.push_back(id); parents.push_back(parent);
+    names.push_back(arena->intern(name)); albums.push_back(arena->intern(album));
+    duration_ms.push_back(ms);
+}
+
+void ItemList::insert(size_t at, const ItemList& src, size_t i) {
+    bool same = src.arena == arena;
+    ids.insert(ids.begin() + at, src.ids[i]); parents.insert(parents.begin() + at, src.parents[i]);
+    names.insert(names.begin() + at, same ? src.names[i] : arena->intern(src.name(i)));
+    albums.insert(albums.begin() + at, same ? src.albums[i] : arena->intern(src.album(i)));
+    duration_ms.insert(duration_ms.begin() + at, src.duration_ms[i]);
+}
+
+void ItemList::set(size_t at, const ItemList& src, size_t i) {
+    bool same = src.arena == arena;
+    ids[at] = src.ids[i]; parents[at] = src.parents[i];
+    names[at] = same ? src.names[i] : arena->intern(src.name(i));
+    albums[at] = same ? src.albums[i] : arena->intern(src.album(i));
+    duration_ms[at] = src.duration_ms[i];
+}
+
+void ItemList::append(const ItemList& src) {
+    if (src.arena == arena) {
+        ids.insert(ids.end(), src.ids.begin(), src.ids.end());
+        parents.insert(parents.end(), src.parents.begin(), src.parents.end());
+        names.insert(names.end(), src.names.begin(), src.names.end());
+        albums.insert(albums.end(), src.albums.begin(), src.albums.end());
+        duration_ms.insert(duration_ms.end(), src.duration_ms.begin(), src.duration_ms.end());
+        return;
+    }
+    for (size_t i = 0; i < src.size(); i++) push(src.ids[i], src.name(i), src.album(i), src.parents[i], src.duration_ms[i]);
+}
+
+void ItemList::erase(size_t i) {
+    ids.erase(ids.begin() + i); parents.erase(parents.begin() + i);
+    names.erase(names.begin() + i); albums.erase(albums.begin() + i);
+    duration_ms.erase(duration_ms.begin() + i);
+}
+
+int ItemList::find(const ItemId& id) const {
+    for (size_t i = 0; i < ids.size(); i++) if (ids[i] == id) return (int)i;
+    return -1;
+}
+
+size_t ItemList::bytes() const {
+    return (ids.capacity() + parents.capacity()) * sizeof(ItemId) +
+           (names.capacity() + albums.capacity() + duration_ms.capacity()) * sizeof(uint32_t);
+}
+
+void arena_compact(StringArena& a, ItemList* const* lists, size_t n) {
+    StringArena fresh;
+    for (size_t l = 0; l < n; l++) {
+        ItemList& list = *lists[l];
+        for (size_t i = 0; i < list.size(); i++) {
+            list.names[i] = fresh.intern(a.at(list.names[i]));
+            list.albums[i] = fresh.intern(a.at(list.albums[i]));
+        }
+    }
+    a.data.swap(fresh.data); a.slots.swap(fresh.slots); a.count = fresh.count;
+}
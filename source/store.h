@@ -0,0 +1,59 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+// --- Item store ---
+// Library lists as columns over an interning string arena, so an album name
+// shared by a dozen tracks is stored once. Ids are Jellyfin's 32-digit hex
+// GUIDs packed into 16 bytes. Platform-free so tools/store_bench can measure it.
+#define ITEM_ID_HEX 33 // 32 digits + NUL
+
+struct ItemId {
+    uint8_t b[16];
+    bool operator==(const ItemId& o) const { return !memcmp(b, o.b, sizeof(b)); }
+    bool operator!=(const ItemId& o) const { return !(*this == o); }
+    bool empty() const { static const ItemId zero = {}; return *this == zero; }
+};
+
+bool item_id_parse(ItemId* out, const char* s);   // dashes are skipped
+void item_id_format(const ItemId& id, char* out); // ITEM_ID_HEX bytes
+
+struct StringArena {
+    std::vector<char> data;      // NUL-terminated strings back to back; offset 0 is ""
+    std::vector<uint32_t> slots; // hash table of offset + 1, 0 when free
+    size_t count = 0;
+
+    uint32_t intern(const char* s);
+    const char* at(uint32_t off) const { return data.data() + off; }
+    void clear();
+    bool rebuild(); // re-index data after loading it wholesale
+    size_t bytes() const { return data.capacity() + slots.capacity() * sizeof(uint32_t); }
+};
+
+struct ItemList {
+    StringArena* arena;
+    std::vector<ItemId> ids, parents;    // parent: the album for tracks, empty for albums
+    std::vector<uint32_t> names, albums; // arena offsets
+    std::vector<uint32_t> duration_ms;
+
+    explicit ItemList(StringArena* a = NULL) : arena(a) {}
+    size_t size() const { return ids.size(); }
+    bool empty() const { return ids.empty(); }
+    const char* name(size_t i) const { return arena->at(names[i]); }
+    const char* album(size_t i) const { return arena->at(albums[i]); }
+
+    void clear();
+    void push(const ItemId& id, const char* name, const char* album, const ItemId& parent, uint32_t ms);
+    void insert(size_t at, const ItemList& src, size_t i); // re-interns when src has another arena
+    void set(size_t at, const ItemList& src, size_t i);
+    void append(const ItemList& src);
+    void erase(size_t i);
+    int find(const ItemId& id) const;
+    size_t bytes() const; // column capacity, arena not included
+};
+
+// Rebuilds a from just the strings the lists use, remapping them. Every list
+// on a must be passed; the others are left pointing at the wrong strings.
+void arena_compact(StringArena& a, ItemList* const* lists, size_t n);
@@ -0,0 +1,117 @@
+#include "stream.h"
+#include "audio.h"
+#include "net.h"
+#include <string.h>
+#include <stdlib.h>
+#include <atomic>
+
+#define FILE_CHUNK (16 * 1024)
+#define SEEK_DECODE_S 30 // past this, a compressed cache file is slower to decode up to than asking the server
+#define WAITED_TICKS (SYSCLOCK_ARM11 / 200) // a write this slow waited for room in a ring
+#define BURST_BYTES (64 * 1024)             // about what a socket holds meanwhile
+
+static std::atomic<u32> received(0), timed_bytes(0), timed_us(0);
+
+static size_t pcm_callback(void *ptr, size_t size, size_t nmemb, void *userdata) {
+    Stream* s = (Stream*)userdata;
+    size_t total = size * nmemb;
+    return audio_write(&s->pcm, ptr, total, &s->run) == total ? total : 0;
+}
+
+static size_t encoded_callback(void *ptr, size_t size, size_t nmemb, void *userdata) {
+    Stream* s = (Stream*)userdata;
+    size_t total = size * nmemb;
+    return decoder_write(&s->dec, ptr, total, &s->run) == total ? total : 0;
+}
+
+// Times the gaps between writes. After a write that had to wait for the
+// player, what piled up in the socket arrives at memory speed, so the next
+// BURST_BYTES aren't timed: a full buffer must not read as a fast link.
+static size_t net_callback(void *ptr, size_t size, size_t nmemb, void *userdata) {
+    Stream* s = (Stream*)userdata;
+    size_t total = size * nmemb;
+    u64 t0 = svcGetSystemTick();
+    received += total;
+    if (s->burst) s->burst = total < s->burst ? s->burst - total : 0;
+    else if (s->rate_tick) { timed_bytes += total; timed_us += (u32)((t0 - s->rate_tick) * 1000000 / SYSCLOCK_ARM11); }
+    cache_writer_push(&s->cw, ptr, total);
+    size_t n = s->codec == CODEC_PCM ? pcm_callback(ptr, size, nmemb, s) : encoded_callback(ptr, size, nmemb, s);
+    s->rate_tick = svcGetSystemTick();
+    if (s->rate_tick - t0 > WAITED_TICKS) s->burst = BURST_BYTES;
+    return n;
+}
+
+static void read_cache_file(Stream* s) {
+    FILE* f = fopen(s->url, "rb");
+    u8* buf = (u8*)malloc(FILE_CHUNK);
+    if (f && s->codec == CODEC_PCM && s->start_frame) fseek(f, (long)(s->start_frame * FRAME_BYTES), SEEK_SET);
+    while (f && buf && s->run) {
+        size_t n = fread(buf, 1, FILE_CHUNK, f);
+        if (!n || (s->codec == CODEC_PCM ? pcm_callback : encoded_callback)(buf, 1, n, s) != n) break;
+    }
+    free(buf);
+    if (f) fclose(f);
+}
+
+static void* net_thread(void* arg) {
+    Stream* s = (Stream*)arg;
+    if (s->from_cache) read_cache_file(s);
+    else {
+        bool caching = !s->start_frame && cache_writer_begin(&s->cw, s->key);
+        CURL *curl = curl_easy_init();
+        net_setup(curl, &s->run); // also unblocks stream_close() while the server is slow
+        curl_easy_setopt(curl, CURLOPT_URL, s->url);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, net_callback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, s);
+        long code = 0;
+        CURLcode res = net_perform(curl, NET_STREAM, &code);
+        curl_easy_cleanup(curl);
+        if (caching) cache_writer_finish(&s->cw, res == CURLE_OK && code == 200 && s->run);
+    }
+    if (s->codec == CODEC_PCM) audio_end_stream(&s->pcm); else decoder_end(&s->dec);
+    s->net_done = true;
+    return NULL;
+}
+
+static void stream_close_source(Stream* s) {
+    if (s->from_cache) cache_release(s->key);
+    s->from_cache = false;
+}
+
+bool stream_open(Stream* s, const char* url, Codec codec, const char* key, u64 start_frame) {
+    stream_close(s);
+    size_t bytes = audio_ring_bytes();
+    if (s->pcm.size != bytes && !s->pcm.init(bytes)) return false;
+    s->pcm.reset();
+    s->codec = codec;
+    strncpy(s->key, key, CACHE_KEY_LEN - 1); s->key[CACHE_KEY_LEN - 1] = '\0';
+    s->start_frame = start_frame;
+    bool decode_far = codec != CODEC_PCM && start_frame > (u64)SEEK_DECODE_S * HARDWARE_RATE;
+    s->from_cache = !decode_far && cache_lookup(key, s->url, sizeof(s->url));
+    if (!s->from_cache) { strncpy(s->url, url, sizeof(s->url) - 1); s->url[sizeof(s->url) - 1] = '\0'; }
+    if (codec != CODEC_PCM && !decoder_start(&s->dec, codec, &s->pcm, s->from_cache ? start_frame : 0)) { stream_close_source(s); return false; }
+    s->run = true; s->net_done = false; s->rate_tick = 0; s->burst = 0;
+    if (pthread_create(&s->net_thread, NULL, net_thread, s) != 0) { s->run = false; decoder_stop(&s->dec); stream_close_source(s); return false; }
+    s->open = true;
+    return true;
+}
+
+// The feeder must no longer be reading s->pcm.
+void stream_close(Stream* s) {
+    if (!s->open) return;
+    s->run = false;
+    pthread_join(s->net_thread, NULL);
+    decoder_stop(&s->dec);
+    stream_close_source(s);
+    s->open = false;
+}
+
+void stream_free(Stream* s) {
+    stream_close(s);
+    decoder_free(&s->dec);
+    s->pcm.release(); s->cw.ring.release();
+}
+
+u32 stream_received() { return received.load(); }
+
+void stream_timed(u32* bytes, u32* us) { *bytes = timed_bytes.load(); *us = timed_us.load(); }
@@ -0,0 +1,41 @@
+#pragma once
+#include <3ds.h>
+#include <pthread.h>
+#include "cache.h"
+#include "codec.h"
+#include "decoder.h"
+#include "pcm_ring.h"
+
+// --- Track stream ---
+// One track being fetched: source thread -> (decoder) -> PCM ring. The
+// source is either the network, teed into the SD cache, or a cache file.
+// The player keeps two of these so the next queue item can load while the
+// current one plays.
+struct Stream {
+    PcmRing pcm;
+    Decoder dec;
+    CacheWriter cw;
+    Codec codec = CODEC_PCM;
+    u64 start_frame = 0;         // where in the track the stream starts, after a seek
+    char url[1024];              // stream URL, or the cache file when from_cache
+    char key[CACHE_KEY_LEN];
+    pthread_t net_thread;
+    u64 rate_tick = 0;           // net thread: when the last write returned, 0 before the first
+    u32 burst = 0;               // net thread: bytes still to leave untimed after a wait on the ring
+    bool open = false, from_cache = false;
+    volatile bool run = false, net_done = false;
+};
+
+// Plays from the cache when key is stored there, otherwise fetches url and
+// tries to cache it under key. A seek passes start_frame: a cached PCM file
+// is read from that offset and a compressed one decoded from the top with
+// everything before it dropped. url must already start there
+// (StartTimeTicks), and is not cached since it is only part of the track.
+bool stream_open(Stream* s, const char* url, Codec codec, const char* key, u64 start_frame = 0);
+void stream_close(Stream* s);
+void stream_free(Stream* s); // closes it and releases its rings
+u32 stream_received(); // network bytes taken in by all streams so far, wrapping
+// The part of those bytes that came in while the stream was waiting on the
+// network, and the microseconds spent waiting: their ratio is the link's
+// rate, not the player's. Running totals, wrapping.
+void stream_timed(u32* bytes, u32* us);
@@ -0,0 +1,20 @@
+#include "text.h"
+#include <string.h>
+
+u32 text_parses = 0;
+
+const C2D_Text* text_line(TextLine* l, const char* s) {
+    if (l->buf && !strncmp(l->str, s, sizeof(l->str) - 1)) return &l->text;
+    if (!l->buf && !(l->buf = C2D_TextBufNew(TEXT_LINE_GLYPHS))) return NULL;
+    strncpy(l->str, s, sizeof(l->str) - 1); l->str[sizeof(l->str) - 1] = '\0';
+    C2D_TextBufClear(l->buf);
+    C2D_TextParse(&l->text, l->buf, l->str);
+    C2D_TextOptimize(&l->text);
+    text_parses++;
+    return &l->text;
+}
+
+void text_line_free(TextLine* l) {
+    if (l->buf) C2D_TextBufDelete(l->buf);
+    l->buf = NULL;
+}
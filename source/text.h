@@ -0,0 +1,18 @@
+#pragma once
+#include <citro2d.h>
+
+// --- Cached text ---
+// C2D_TextParse shapes every glyph again, so each piece of UI text is parsed
+// into a buffer of its own and kept until the string it shows changes.
+#define TEXT_LINE_GLYPHS 128 // longer strings are cut; nothing on screen fits that many
+
+struct TextLine {
+    C2D_TextBuf buf = NULL;
+    C2D_Text text;
+    char str[TEXT_LINE_GLYPHS];
+};
+
+extern u32 text_parses; // running count, for the frame stats
+
+const C2D_Text* text_line(TextLine* l, const char* s); // reparses only when s changed
+void text_line_free(TextLine* l);
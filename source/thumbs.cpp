@@ -0,0 +1,190 @@
+#include "thumbs.h"
+#include "art.h"
+#include "net.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define THUMB_MAX_DOWNLOAD (256 * 1024)
+#define ATLAS_COLS         (THUMB_ATLAS_SIZE / THUMB_SIZE)
+
+enum SlotState { SLOT_FREE, SLOT_LOADING, SLOT_READY, SLOT_FAILED };
+
+// Slots belong to the main thread. The worker only writes the pixels of the
+// slot it was handed, and reports back through done.
+struct Slot {
+    std::string key;
+    u32 last_use;
+    SlotState state;
+    Tex3DS_SubTexture sub;
+    C2D_Image image;
+};
+struct Job { int slot; std::string url; };
+struct Done { int slot; bool ok, cancelled; u16 w, h; };
+
+static C3D_Tex atlas;
+static bool atlas_ok = false;
+static Slot slots[THUMB_SLOTS];
+static u32 frame = 0;
+
+static std::vector<Job> jobs;          // most urgent first
+static std::vector<ThumbJob> wanted_last;
+static std::vector<Done> done;
+static int busy = -1;                  // slot being fetched
+static volatile bool busy_run = false; // cleared to cancel that fetch
+static LightLock lock;
+static LightEvent job_event;
+static Thread worker = NULL;
+static volatile bool worker_run = false;
+
+// --- Worker ---
+struct Body { u8* data; size_t len; };
+
+static size_t body_write(void* p, size_t s, size_t n, void* u) {
+    Body* b = (Body*)u; size_t t = s * n;
+    if (b->len + t > THUMB_MAX_DOWNLOAD) return 0;
+    memcpy(b->data + b->len, p, t); b->len += t;
+    return t;
+}
+
+static void thumb_worker(void*) {
+    CURL* c = curl_easy_init(); // kept across jobs so the connection stays open
+    Body b = { (u8*)malloc(THUMB_MAX_DOWNLOAD), 0 };
+    while (worker_run) {
+        LightLock_Lock(&lock);
+        bool have = !jobs.empty();
+        Job job; if (have) { job = jobs.front(); jobs.erase(jobs.begin()); busy = job.slot; busy_run = true; }
+        LightLock_Unlock(&lock);
+        if (!have) { LightEvent_WaitTimeout(&job_event, 500000000LL); continue; }
+
+        Done d = { job.slot, false, false, 0, 0 };
+        b.len = 0;
+        curl_easy_reset(c); net_setup(c, &busy_run);
+        curl_easy_setopt(c, CURLOPT_URL, job.url.c_str());
+        curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, body_write); curl_easy_setopt(c, CURLOPT_WRITEDATA, &b);
+        long code = 0;
+        if (b.data && net_perform(c, NET_ART, &code) == CURLE_OK && code == 200)
+            d.ok = art_decode_jpeg_at(b.data, b.len, THUMB_SIZE, &atlas, job.slot % ATLAS_COLS * THUMB_SIZE, job.slot / ATLAS_COLS * THUMB_SIZE, &d.w, &d.h);
+
+        LightLock_Lock(&lock);
+        d.cancelled = !d.ok && !busy_run;
+        busy = -1; done.push_back(d);
+        LightLock_Unlock(&lock);
+    }
+    free(b.data);
+    curl_easy_cleanup(c);
+}
+
+void thumbs_init() {
+    atlas_ok = C3D_TexInit(&atlas, THUMB_ATLAS_SIZE, THUMB_ATLAS_SIZE, GPU_RGBA8);
+    if (!atlas_ok) return;
+    C3D_TexSetFilter(&atlas, GPU_LINEAR, GPU_LINEAR);
+    for (Slot& s : slots) { s.state = SLOT_FREE; s.last_use = 0; }
+    LightLock_Init(&lock);
+    LightEvent_Init(&job_event, RESET_ONESHOT);
+    s32 prio = 0x30; svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+    worker_run = true;
+    worker = threadCreate(thumb_worker, NULL, 32 * 1024, prio + 1, -2, false);
+}
+
+void thumbs_exit() {
+    if (worker) { worker_run = false; busy_run = false; LightEvent_Signal(&job_event); threadJoin(worker, U64_MAX); threadFree(worker); worker = NULL; }
+    jobs.clear(); done.clear(); wanted_last.clear();
+    if (atlas_ok) C3D_TexDelete(&atlas);
+    atlas_ok = false;
+}
+
+// --- Slots ---
+static int find_slot(const std::string& key) {
+    for (int i = 0; i < THUMB_SLOTS; i++) if (slots[i].state != SLOT_FREE && slots[i].key == key) return i;
+    return -1;
+}
+
+// A free slot, or the least recently drawn loaded one that wasn't drawn
+// last frame, which the GPU may still be reading
+static int claim_slot() {
+    int victim = -1;
+    for (int i = 0; i < THUMB_SLOTS; i++) {
+        const Slot& s = slots[i];
+        if (s.state == SLOT_FREE) return i;
+        if (s.state == SLOT_LOADING || s.last_use + 1 >= frame) continue;
+        if (victim < 0 || s.last_use < slots[victim].last_use) victim = i;
+    }
+    return victim;
+}
+
+// Takes the worker's results, and says whether a cancelled load came back.
+// Call with the lock held.
+static bool apply_done() {
+    bool cancelled = false;
+    for (const Done& d : done) {
+        Slot& s = slots[d.slot];
+        if (d.ok) {
+            float x = (float)(d.slot % ATLAS_COLS * THUMB_SIZE), y = (float)(d.slot / ATLAS_COLS * THUMB_SIZE);
+            s.sub.width = d.w; s.sub.height = d.h;
+            s.sub.left = x / THUMB_ATLAS_SIZE; s.sub.right = (x + d.w) / THUMB_ATLAS_SIZE;
+            s.sub.top = 1.0f - y / THUMB_ATLAS_SIZE; s.sub.bottom = 1.0f - (y + d.h) / THUMB_ATLAS_SIZE;
+            s.image.tex = &atlas; s.image.subtex = &s.sub;
+            s.state = SLOT_READY;
+        } else if (d.cancelled) { s.state = SLOT_FREE; s.key.clear(); cancelled = true; }
+        else s.state = SLOT_FAILED; // kept, so a missing cover isn't fetched on every scroll
+    }
+    done.clear();
+    return cancelled;
+}
+
+void thumbs_want(const std::vector<ThumbJob>& wanted) {
+    if (!atlas_ok) return;
+    if (&wanted != &wanted_last) wanted_last = wanted;
+    LightLock_Lock(&lock);
+    apply_done();
+    // Mark everything wanted first, so claiming a slot never recycles one of them
+    std::vector<int> at(wanted.size());
+    for (size_t i = 0; i < wanted.size(); i++) {
+        at[i] = find_slot(wanted[i].key);
+        if (at[i] >= 0) slots[at[i]].last_use = frame;
+    }
+    std::vector<Job> queue;
+    bool keep_busy = false;
+    for (size_t i = 0; i < wanted.size(); i++) {
+        int s = at[i];
+        if (s < 0) {
+            if ((s = claim_slot()) < 0) break;
+            slots[s].key = wanted[i].key; slots[s].state = SLOT_LOADING; slots[s].last_use = frame;
+        }
+        if (slots[s].state != SLOT_LOADING) continue;
+        if (s == busy) { keep_busy = true; continue; }
+        Job j; j.slot = s; j.url = wanted[i].url;
+        queue.push_back(j);
+    }
+    // Queued loads that fell out of the set give their slots back; the one in flight is cut short
+    for (const Job& j : jobs) {
+        bool still = false;
+        for (const Job& q : queue) if (q.slot == j.slot) { still = true; break; }
+        if (!still) { slots[j.slot].state = SLOT_FREE; slots[j.slot].key.clear(); }
+    }
+    if (busy >= 0 && !keep_busy) busy_run = false;
+    jobs.swap(queue);
+    bool any = !jobs.empty();
+    LightLock_Unlock(&lock);
+    if (any) LightEvent_Signal(&job_event);
+}
+
+const C2D_Image* thumb_get(const char* key) {
+    for (Slot& s : slots) {
+        if (s.state != SLOT_READY || s.key != key) continue;
+        s.last_use = frame;
+        return &s.image;
+    }
+    return NULL;
+}
+
+void thumbs_collect() {
+    frame++;
+    if (!atlas_ok) return;
+    LightLock_Lock(&lock);
+    bool again = apply_done();
+    LightLock_Unlock(&lock);
+    // A load cancelled by one set may be wanted by a later one that came
+    // before it finished; ask again, as the caller only does when it scrolls
+    if (again) thumbs_want(wanted_last);
+}
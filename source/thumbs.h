@@ -0,0 +1,26 @@
+#pragma once
+#include <3ds.h>
+#include <citro2d.h>
+#include <string>
+#include <vector>
+
+// --- Cover thumbnails ---
+// Small covers for the album grid, all packed into one atlas texture so a
+// screenful of them draws with a single bind. The atlas is a grid of
+// THUMB_SIZE slots, recycled least recently drawn first. A worker fetches
+// and decodes straight into a slot, in the order the last thumbs_want()
+// asked for; loads no longer wanted are dropped, and the one in flight is
+// cancelled.
+#define THUMB_SIZE       64
+#define THUMB_ATLAS_SIZE 512 // 64 slots, twice the grid's fetch window
+#define THUMB_SLOTS      ((THUMB_ATLAS_SIZE / THUMB_SIZE) * (THUMB_ATLAS_SIZE / THUMB_SIZE))
+
+struct ThumbJob { std::string key, url; };
+
+void thumbs_init();
+void thumbs_exit();
+
+// Main thread only. thumbs_collect() must run after C3D_FrameBegin, like art_collect().
+void thumbs_want(const std::vector<ThumbJob>& wanted); // most urgent first; replaces the last set
+const C2D_Image* thumb_get(const char* key);             // NULL until loaded
+void thumbs_collect();
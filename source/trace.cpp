@@ -0,0 +1,120 @@
+#include "trace.h"
+#include <3ds.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TRACE_RING 4096 // records between flushes; more than a second's worth
+
+struct TraceInfo { TraceType type; const char* name; };
+static const TraceInfo events[TRACE_EVENT_COUNT] = {
+    { TRACE_SPAN, "update" }, { TRACE_SPAN, "draw" }, { TRACE_SPAN, "feed" },
+    { TRACE_INSTANT, "underrun" }, { TRACE_INSTANT, "rebuffer" }, { TRACE_SPAN, "seek" },
+    { TRACE_COUNTER, "dsp_queued" }, { TRACE_COUNTER, "ring_ms" },
+    { TRACE_SPAN, "transfer" }, { TRACE_SPAN, "connect" }, { TRACE_SPAN, "first_byte" }, { TRACE_SPAN, "jpeg" },
+    { TRACE_COUNTER, "stream_kbps" }, { TRACE_COUNTER, "heap_kb" }, { TRACE_COUNTER, "linear_free_kb" },
+    { TRACE_COUNTER, "link_kbps" }, { TRACE_COUNTER, "rendition_kbps" },
+};
+static const char* const lanes[TRACE_LANE_COUNT] = { "main", "audio", "api", "art", "stream", "pin" };
+
+bool trace_enabled = false;
+
+static FILE* file = NULL;
+static TraceHeader header;
+static TraceRecord ring[TRACE_RING];
+static u32 head = 0, tail = 0, dropped = 0; // head: next free slot; both only grow
+static u64 start = 0;
+static LightLock lock;
+static volatile u32 written = 0; // header.written, for the main thread
+static Thread writer = NULL;
+static volatile bool writer_run = false;
+static LightEvent flush_event;
+
+static u64 ticks_to_us(u64 t) { return t * 1000000 / SYSCLOCK_ARM11; }
+
+// Copies out under the lock and writes without it, wrapping at the end of the file
+static void write_pending() {
+    static TraceRecord batch[TRACE_RING];
+    LightLock_Lock(&lock);
+    u32 n = head - tail;
+    for (u32 i = 0; i < n; i++) batch[i] = ring[(tail + i) % TRACE_RING];
+    tail = head;
+    LightLock_Unlock(&lock);
+    for (u32 done = 0; done < n; ) {
+        u32 slot = header.written % TRACE_FILE_RECORDS;
+        u32 run = n - done; if (run > TRACE_FILE_RECORDS - slot) run = TRACE_FILE_RECORDS - slot;
+        fseek(file, TRACE_HEADER_BYTES + (long)slot * sizeof(TraceRecord), SEEK_SET);
+        fwrite(batch + done, sizeof(TraceRecord), run, file);
+        done += run; header.written += run;
+    }
+    written = (u32)header.written;
+    if (!n) return;
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    fflush(file);
+}
+
+static void writer_thread(void*) {
+    while (writer_run) {
+        LightEvent_WaitTimeout(&flush_event, 2000000000LL);
+        write_pending();
+    }
+}
+
+bool trace_init(const char* path, const char* prev_path) {
+    if (file) return true;
+    remove(prev_path); rename(path, prev_path);
+    if (!(file = fopen(path, "wb+"))) return false;
+    u8 block[TRACE_HEADER_BYTES] = {};
+    header.magic = TRACE_MAGIC; header.version = TRACE_VERSION;
+    header.capacity = TRACE_FILE_RECORDS; header.record_bytes = sizeof(TraceRecord);
+    header.written = 0; header.event_count = TRACE_EVENT_COUNT; header.lane_count = TRACE_LANE_COUNT;
+    size_t at = sizeof(header);
+    for (const TraceInfo& e : events) { block[at++] = e.type; strcpy((char*)block + at, e.name); at += strlen(e.name) + 1; }
+    for (const char* l : lanes) { strcpy((char*)block + at, l); at += strlen(l) + 1; }
+    memcpy(block, &header, sizeof(header));
+    fwrite(block, 1, sizeof(block), file);
+    LightLock_Init(&lock);
+    head = tail = dropped = written = 0;
+    start = svcGetSystemTick();
+    trace_enabled = true;
+    // The SD writes go to a thread below the main one, so they don't land in
+    // the frames being timed
+    LightEvent_Init(&flush_event, RESET_ONESHOT);
+    s32 prio = 0x30; svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+    writer_run = true;
+    writer = threadCreate(writer_thread, NULL, 16 * 1024, prio + 1, -2, false);
+    return true;
+}
+
+void trace_exit() {
+    if (!file) return;
+    if (writer) { writer_run = false; LightEvent_Signal(&flush_event); threadJoin(writer, U64_MAX); threadFree(writer); writer = NULL; }
+    trace_enabled = false;
+    write_pending();
+    fclose(file); file = NULL;
+}
+
+static void put(TraceEvent ev, TraceLane lane, u64 tick, u32 value, u16 arg) {
+    LightLock_Lock(&lock);
+    if (head - tail < TRACE_RING) {
+        TraceRecord& r = ring[head % TRACE_RING];
+        r.t_us = tick > start ? ticks_to_us(tick - start) : 0; r.value = value; r.arg = arg; r.event = ev; r.lane = lane;
+        head++;
+    } else dropped++;
+    LightLock_Unlock(&lock);
+}
+
+void trace_put(TraceEvent ev, TraceLane lane, u32 value, u16 arg) { put(ev, lane, svcGetSystemTick(), value, arg); }
+
+void trace_put_span(TraceEvent ev, TraceLane lane, u64 start_tick, u64 end_tick, u16 arg) {
+    put(ev, lane, start_tick, end_tick > start_tick ? (u32)ticks_to_us(end_tick - start_tick) : 0, arg);
+}
+
+void trace_flush() {
+    if (!file) return;
+    if (writer) LightEvent_Signal(&flush_event);
+    else write_pending();
+}
+
+u32 trace_written() { return written; }
+u32 trace_dropped() { return dropped; }
@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// --- Trace log ---
+// Timestamped spans, instants and counters from every thread. They collect
+// in a ring in memory, and a low-priority thread woken by trace_flush() once
+// a second appends them to a file that is itself a ring of
+// TRACE_FILE_RECORDS, so it always holds the last few minutes before a
+// stutter. The file names its events and lanes, so tools/trace2json can turn
+// it into Chrome trace JSON without this header being current. Off unless
+// trace=1 in config.txt; a disabled call costs one test.
+#define TRACE_MAGIC        0x5254434A // "JCTR"
+#define TRACE_VERSION      1
+#define TRACE_HEADER_BYTES 1024
+#define TRACE_FILE_RECORDS 65536 // 1 MB
+
+enum TraceType { TRACE_SPAN, TRACE_INSTANT, TRACE_COUNTER };
+
+enum TraceEvent {
+    TRACE_UPDATE,     // main loop input and logic
+    TRACE_DRAW,       // arg: screens drawn, 1 top 2 bottom
+    TRACE_FEED,       // feeder filling waveBufs; arg: waveBufs queued after
+    TRACE_UNDERRUN,
+    TRACE_REBUFFER,
+    TRACE_SEEK,       // seek to first audio
+    TRACE_DSP_QUEUED, // waveBufs queued on the DSP
+    TRACE_RING_MS,    // audio buffered in the PCM ring
+    TRACE_NET,        // one transfer; arg: HTTP status
+    TRACE_CONNECT,    // its connection setup, when it opened one
+    TRACE_FIRST_BYTE, // request to first byte
+    TRACE_JPEG,       // cover decode; arg: decoded width
+    TRACE_STREAM_KBPS,
+    TRACE_HEAP_KB,
+    TRACE_LINEAR_KB,  // linear memory free
+    TRACE_LINK_KBPS,  // download rate the ABR measured
+    TRACE_RENDITION_KBPS, // bitrate of each network stream opened in auto quality
+    TRACE_EVENT_COUNT
+};
+
+// Thread a record is drawn on. The net lanes follow NetKind's order.
+enum TraceLane { TRACE_LANE_MAIN, TRACE_LANE_AUDIO, TRACE_LANE_API, TRACE_LANE_ART, TRACE_LANE_STREAM, TRACE_LANE_PIN, TRACE_LANE_COUNT };
+
+// On file: the header, then event_count (type byte, name, NUL) and
+// lane_count (name, NUL) up to TRACE_HEADER_BYTES, then the record ring.
+// Record i of the written lives at slot i % capacity.
+struct TraceHeader {
+    uint32_t magic, version, capacity, record_bytes;
+    uint64_t written;
+    uint32_t event_count, lane_count;
+};
+
+struct TraceRecord {
+    uint64_t t_us;  // since trace_init()
+    uint32_t value; // span: duration in us; instant: 0; counter: the value
+    uint16_t arg;
+    uint8_t event, lane;
+};
+
+extern bool trace_enabled;
+
+// The previous session's log, if any, is kept as prev_path rather than
+// overwritten, so a stutter or crash can still be read after a restart
+bool trace_init(const char* path, const char* prev_path);
+void trace_exit();
+void trace_flush(); // main thread, about once a second
+uint32_t trace_written(); // records handed to the file so far
+uint32_t trace_dropped(); // lost to a full ring between flushes
+
+void trace_put(TraceEvent ev, TraceLane lane, uint32_t value, uint16_t arg); // stamped now
+void trace_put_span(TraceEvent ev, TraceLane lane, uint64_t start_tick, uint64_t end_tick, uint16_t arg);
+
+// Ticks are svcGetSystemTick() values
+static inline void trace_span(TraceEvent ev, TraceLane lane, uint64_t start_tick, uint64_t end_tick, uint16_t arg = 0) {
+    if (trace_enabled) trace_put_span(ev, lane, start_tick, end_tick, arg);
+}
+static inline void trace_instant(TraceEvent ev, TraceLane lane, uint16_t arg = 0) { if (trace_enabled) trace_put(ev, lane, 0, arg); }
+static inline void trace_counter(TraceEvent ev, TraceLane lane, uint32_t value) { if (trace_enabled) trace_put(ev, lane, value, 0); }
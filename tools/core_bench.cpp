@@ -0,0 +1,287 @@
+// Host-side benchmark of the app's stages, run against the mock server.
+//   tools/mock/mock_jellyfin.py --port 8096 [--latency ms] [--bandwidth kB/s] &
+//   core_bench [server] [stage...]
+// Links the same source/ modules as the 3DS build over the host platform
+// layer in tools/host. Stages (all by default):
+//   items   album and track pages: fetch + incremental JSON parse
+//   art     cover fetch -> decode -> tiled texture, through the art worker
+//   decode  art_decode_jpeg alone, the JPEG scaling and tiling
+//   stream  PCM stream to the DSP: time to first audio, underruns, seeks
+//   feed    ring -> waveBuf feeder with the DSP running flat out
+//   queue   building a play queue in order and shuffled
+// Latencies are p50 / p95 / max. The host is far faster than the ARM11, so
+// compare runs with each other rather than with the handheld.
+#include <3ds.h>
+#include "host.h"
+#include "art.h"
+#include "audio.h"
+#include "cache.h"
+#include "library.h"
+#include "net.h"
+#include "queue.h"
+#include "stream.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+static const char* server = "http://127.0.0.1:8096";
+
+static double now_ms() { return svcGetSystemTick() * 1000.0 / SYSCLOCK_ARM11; }
+
+struct Samples {
+    std::vector<double> v;
+    void add(double x) { v.push_back(x); }
+    double total() const { double t = 0; for (double x : v) t += x; return t; }
+    void print(const char* stage, const char* what, const char* unit = "ms") {
+        if (v.empty()) { printf("%-7s %-26s none\n", stage, what); return; }
+        std::sort(v.begin(), v.end());
+        printf("%-7s %-26s %8.2f %8.2f %8.2f %s  (n=%zu)\n", stage, what,
+               v[v.size() / 2], v[std::min(v.size() - 1, v.size() * 95 / 100)], v.back(), unit, v.size());
+    }
+};
+
+static void pump(volatile bool* flag) { while (!*flag) { net_poll(); usleep(100); } }
+
+// --- items ---
+struct PageWait { volatile bool done; int items, total; };
+static PageWait page_wait;
+
+static void on_page(const NetResult* r) {
+    LibraryPage* p = (LibraryPage*)r->user;
+    page_wait.items = p->ok && r->status == 200 ? (int)p->items.size() : -1; page_wait.total = p->total;
+    library_page_free(p);
+    page_wait.done = true;
+}
+
+static void bench_list(const char* what, const char* query) {
+    std::string q = std::string(server) + query;
+    Samples page; int items = 0, total = 1;
+    NetStats before = net_get_stats(NET_API);
+    double t0 = now_ms(), first = 0;
+    for (int start = 0; start < total; start += LIBRARY_PAGE) {
+        page_wait.done = false;
+        double t = now_ms();
+        library_fetch(q.c_str(), start, LIBRARY_PAGE, 0, on_page);
+        pump(&page_wait.done);
+        if (page_wait.items < 0) { printf("items   %s: page at %d failed\n", what, start); return; }
+        page.add(now_ms() - t);
+        if (!start) first = now_ms() - t0;
+        items += page_wait.items; total = page_wait.total;
+    }
+    double ms = now_ms() - t0;
+    NetStats s = net_get_stats(NET_API);
+    u32 reqs = s.requests - before.requests;
+    page.print("items", (std::string(what) + " page").c_str());
+    printf("items   %-26s %8d items in %.0f ms, %.0f items/s, %.2f MB/s, first page %.1f ms\n", what, items, ms,
+           items * 1000.0 / ms, (s.bytes - before.bytes) / 1048576.0 / (ms / 1000.0), first);
+    if (reqs) printf("items   %-26s %8.2f ms to first byte, %.2f ms total per page\n", what,
+                     (s.first_byte_us - before.first_byte_us) / 1000.0 / reqs, (s.total_us - before.total_us) / 1000.0 / reqs);
+}
+
+static void bench_items() {
+    bench_list("albums", "/Items?IncludeItemTypes=MusicAlbum&Recursive=true&SortBy=SortName&Fields=DateLastSaved");
+    bench_list("tracks", "/Items?IncludeItemTypes=Audio&Recursive=true&Fields=DateLastSaved");
+}
+
+// --- art ---
+static void art_url(char* url, size_t n, int i) {
+    snprintf(url, n, "%s/Items/a%031x/Images/Primary?maxWidth=%d&maxHeight=%d&api_key=mocktoken", server, i, ART_MAX_SIZE, ART_MAX_SIZE);
+}
+
+static void bench_art() {
+    const int n = 48;
+    std::vector<double> asked(n);
+    Samples lat;
+    HostStats h0 = host_get_stats();
+    double t0 = now_ms();
+    // Issued oldest first; the worker serves newest first, like a scrolling list
+    for (int i = 0; i < n; i++) {
+        char key[16], url[512]; snprintf(key, sizeof(key), "%d", i); art_url(url, sizeof(url), i);
+        asked[i] = now_ms(); art_request(key, url, ART_MAX_SIZE);
+    }
+    int got = 0, failed = 0;
+    while (got + failed < n) {
+        char key[16]; ArtTexture* a;
+        if (!art_take(key, sizeof(key), &a)) { usleep(100); continue; }
+        if (a) { got++; lat.add(now_ms() - asked[atoi(key)]); art_free(a); } else failed++;
+    }
+    double ms = now_ms() - t0;
+    HostStats h1 = host_get_stats();
+    lat.print("art", "request -> texture");
+    printf("art     %-26s %8d covers in %.0f ms, %.1f covers/s, %u uploads (%.1f MB), %d failed\n", "throughput", got, ms,
+           got * 1000.0 / ms, h1.tex_uploads - h0.tex_uploads, (h1.tex_bytes - h0.tex_bytes) / 1048576.0, failed);
+}
+
+static void bench_decode() {
+    char url[512]; art_url(url, sizeof(url), 0);
+    NetResult r;
+    if (!net_fetch(url, NULL, &r) || r.status != 200) { printf("decode  cover fetch failed\n"); free(r.body); return; }
+    const u16 sizes[] = { ART_MAX_SIZE, 128, 64 };
+    for (u16 size : sizes) {
+        Samples each; double px = 0;
+        for (int i = 0; i < 200; i++) {
+            double t = now_ms();
+            ArtTexture* a = art_decode_jpeg((const u8*)r.body, r.len, size);
+            each.add(now_ms() - t);
+            if (a) px += a->width * a->height;
+            art_free(a);
+        }
+        char what[64]; snprintf(what, sizeof(what), "jpeg %zu B -> %u px box", r.len, size);
+        each.print("decode", what);
+        printf("decode  %-26s %8.1f MPix/s out\n", "", px / 1e6 / (each.total() / 1000.0));
+    }
+    free(r.body);
+}
+
+// --- stream ---
+static const char* stream_q = "static=false&audioCodec=pcm_s16le&container=raw&audioChannels=2&audioSampleRate=48000";
+
+static void track_url(char* url, size_t n, int album, int track, u64 start_frame) {
+    snprintf(url, n, "%s/Audio/b%015x%016x/stream?%s&api_key=mocktoken", server, album, track, stream_q);
+    if (start_frame) { size_t l = strlen(url); snprintf(url + l, n - l, "&StartTimeTicks=%llu", (unsigned long long)(start_frame * 10000000ULL / HARDWARE_RATE)); }
+}
+
+static bool wait_position(u64 past, double timeout_ms) {
+    double t0 = now_ms();
+    while (audio_get_stats().position <= past) { if (now_ms() - t0 > timeout_ms) return false; usleep(200); }
+    return true;
+}
+
+static void bench_stream() {
+    static Stream st;
+    char url[512];
+    Samples ttfa;
+    for (int i = 0; i < 5; i++) {
+        track_url(url, sizeof(url), 0, i, 0);
+        double t = now_ms();
+        if (!stream_open(&st, url, CODEC_PCM, "")) { printf("stream  open failed\n"); return; }
+        audio_play(&st.pcm);
+        if (!wait_position(0, 30000)) { printf("stream  no audio after 30 s\n"); break; }
+        ttfa.add(now_ms() - t);
+        audio_stop(); stream_close(&st);
+    }
+    ttfa.print("stream", "open -> first audio");
+    printf("stream  %-26s %8u ms prebuffer\n", "", audio_config.prebuffer_ms);
+
+    // A few seconds of real-time play, then seeks
+    track_url(url, sizeof(url), 1, 0, 0);
+    stream_open(&st, url, CODEC_PCM, ""); audio_play(&st.pcm);
+    AudioStats a0 = audio_get_stats(); HostStats h0 = host_get_stats();
+    wait_position(0, 30000);
+    usleep(4000000);
+    AudioStats a = audio_get_stats(); HostStats h1 = host_get_stats();
+    printf("stream  %-26s %8.2f s played, %u underruns, %u rebuffers, %llu starved DSP frames\n", "real time",
+           a.position / (double)HARDWARE_RATE, a.underruns - a0.underruns, a.rebuffers - a0.rebuffers,
+           (unsigned long long)(h1.starved_frames - h0.starved_frames));
+
+    // In the ring: the queued waveBufs go and the ring skips ahead
+    Samples in_ring;
+    for (int i = 0; i < 8; i++) {
+        u64 target = audio_get_stats().position + 2 * HARDWARE_RATE; // past what the DSP holds
+        u32 seeks = audio_get_stats().seeks;
+        if (!audio_seek(target)) { usleep(300000); continue; }
+        while (audio_get_stats().seeks == seeks) usleep(100);
+        in_ring.add(audio_get_stats().seek_ms);
+        usleep(300000);
+    }
+    in_ring.print("stream", "seek within ring");
+
+    // Past the ring: reopen at StartTimeTicks, like seek_to() does
+    Samples reopen;
+    for (int i = 0; i < 5; i++) {
+        u64 target = (u64)(30 + i * 20) * HARDWARE_RATE;
+        u64 tick = svcGetSystemTick(); u32 seeks = audio_get_stats().seeks;
+        audio_stop(); stream_close(&st);
+        track_url(url, sizeof(url), 1, 0, target);
+        stream_open(&st, url, CODEC_PCM, "", target);
+        audio_play(&st.pcm, target, tick);
+        double t0 = now_ms();
+        while (audio_get_stats().seeks == seeks && now_ms() - t0 < 30000) usleep(100);
+        reopen.add(audio_get_stats().seek_ms);
+    }
+    reopen.print("stream", "seek by reopening");
+    audio_stop(); stream_close(&st);
+}
+
+// Feeds from a producer thread instead of the network, so only the
+// ring -> waveBuf path is measured
+static PcmRing feed_ring;
+static volatile bool feed_run;
+
+static void* feed_producer(void*) {
+    static s16 block[4096 * 2];
+    for (int i = 0; i < 4096; i++) block[i * 2] = block[i * 2 + 1] = (s16)((i & 127) * 64);
+    for (u64 left = 600ULL * HARDWARE_RATE * FRAME_BYTES; left && feed_run; ) {
+        size_t n = left < sizeof(block) ? left : sizeof(block);
+        left -= audio_write(&feed_ring, block, n, &feed_run);
+    }
+    audio_end_stream(&feed_ring);
+    return NULL;
+}
+
+static void bench_feed() {
+    if (!feed_ring.data && !feed_ring.init(audio_ring_bytes())) return;
+    feed_ring.reset();
+    host_set_dsp_speed(0);
+    AudioStats a0 = audio_get_stats(); HostStats h0 = host_get_stats();
+    double t0 = now_ms();
+    feed_run = true;
+    pthread_t t; pthread_create(&t, NULL, feed_producer, NULL);
+    audio_play(&feed_ring);
+    while (!audio_drained() && now_ms() - t0 < 120000) usleep(200);
+    double ms = now_ms() - t0;
+    feed_run = false; pthread_join(t, NULL);
+    AudioStats a = audio_get_stats(); HostStats h1 = host_get_stats();
+    double sec = (h1.samples_played - h0.samples_played) / (double)HARDWARE_RATE;
+    printf("feed    %-26s %8.1f s of audio in %.0f ms, %.0fx real time, %.1f MB/s, DSP ran dry %u times\n", "ring -> waveBuf -> DSP",
+           sec, ms, sec * 1000 / ms, sec * HARDWARE_RATE * FRAME_BYTES / 1048576.0 / (ms / 1000), a.underruns - a0.underruns);
+    audio_stop();
+    host_set_dsp_speed(1);
+}
+
+// --- queue ---
+static void bench_queue() {
+    std::vector<int> items, q;
+    for (int i = 0; i < 10000; i++) items.push_back(i);
+    for (int shuffle = 0; shuffle < 2; shuffle++) {
+        Samples each;
+        for (int i = 0; i < 100; i++) {
+            double t = now_ms();
+            queue_build(q, items, i * 97, shuffle);
+            each.add((now_ms() - t) * 1000);
+            if (q.size() != items.size() || q[0] != i * 97) { printf("queue   wrong queue\n"); return; }
+        }
+        each.print("queue", shuffle ? "10000 items, shuffled" : "10000 items, in order", "us");
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) server = argv[1];
+    static const struct { const char* name; void (*run)(); } stages[] = {
+        { "items", bench_items }, { "art", bench_art }, { "decode", bench_decode },
+        { "stream", bench_stream }, { "feed", bench_feed }, { "queue", bench_queue },
+    };
+    cache_config.max_mb = 0; // measure the network path, never the SD cache
+    net_init(); net_set_token("mocktoken");
+    cache_init(); art_init();
+    if (!audio_init()) { printf("audio_init failed\n"); return 1; }
+
+    NetResult r;
+    char url[512]; snprintf(url, sizeof(url), "%s/Items?Limit=0", server);
+    if (!net_fetch(url, NULL, &r) || r.status != 200) { printf("no server at %s\n", server); return 1; }
+    free(r.body);
+
+    printf("%-7s %-26s %8s %8s %8s\n", "stage", "", "p50", "p95", "max");
+    for (auto& s : stages) {
+        bool run = argc <= 2;
+        for (int i = 2; i < argc; i++) if (!strcmp(argv[i], s.name)) run = true;
+        if (run) s.run();
+    }
+    audio_exit(); art_exit(); cache_exit(); net_exit();
+    return 0;
+}
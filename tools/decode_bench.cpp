@@ -0,0 +1,76 @@
+// Host-side decoder benchmark.
+//   decode_bench <file> [pcm|opus|mp3|flac] [iterations]
+// Feeds the file through the same codec_decode() the 3DS uses and reports how
+// long decoding one second of audio takes. Grab test files with the stream
+// URL the app builds (see codec_queries) so the encoder settings match.
+#include "codec.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct MemSource { const uint8_t* data; size_t size, pos; uint64_t frames; };
+
+static size_t mem_read(void* user, void* dst, size_t len) {
+    MemSource* m = (MemSource*)user;
+    size_t n = m->size - m->pos; if (len < n) n = len;
+    // Hand out network-sized chunks so feed-style decoders see realistic input
+    if (n > 16 * 1024) n = 16 * 1024;
+    memcpy(dst, m->data + m->pos, n); m->pos += n;
+    return n;
+}
+
+static bool count_write(void* user, const int16_t*, size_t count) {
+    ((MemSource*)user)->frames += count;
+    return true;
+}
+
+static double now_ms() {
+    timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int guess_codec(const char* path) {
+    const char* ext = strrchr(path, '.');
+    if (!ext) return CODEC_PCM;
+    if (!strcmp(ext, ".ogg") || !strcmp(ext, ".opus")) return CODEC_OPUS;
+    for (int i = 0; codec_names[i]; i++) if (!strcmp(ext + 1, codec_names[i])) return i;
+    return CODEC_PCM;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) { fprintf(stderr, "usage: %s <file> [pcm|opus|mp3|flac] [iterations]\n", argv[0]); return 1; }
+    int codec = guess_codec(argv[1]);
+    if (argc > 2) for (int i = 0; codec_names[i]; i++) if (!strcmp(argv[2], codec_names[i])) codec = i;
+    int iterations = argc > 3 ? atoi(argv[3]) : 3;
+    if (iterations < 1) iterations = 1;
+
+    FILE* f = fopen(argv[1], "rb");
+    if (!f) { perror(argv[1]); return 1; }
+    fseek(f, 0, SEEK_END); long size = ftell(f); fseek(f, 0, SEEK_SET);
+    uint8_t* data = (uint8_t*)malloc(size);
+    if (!data || fread(data, 1, size, f) != (size_t)size) { fprintf(stderr, "read failed\n"); return 1; }
+    fclose(f);
+
+    double best = 0; uint64_t frames = 0;
+    for (int it = 0; it < iterations; it++) {
+        MemSource src = { data, (size_t)size, 0, 0 };
+        CodecIo io = { mem_read, count_write, &src };
+        double t0 = now_ms();
+        bool ok = codec_decode((Codec)codec, io);
+        double t = now_ms() - t0;
+        if (!ok) { fprintf(stderr, "%s: decode failed\n", codec_names[codec]); return 1; }
+        if (it == 0 || t < best) best = t;
+        frames = src.frames;
+    }
+    free(data);
+
+    double secs = frames / 48000.0;
+    printf("codec     %s\n", codec_names[codec]);
+    printf("input     %.1f KB (%.1f kbit/s)\n", size / 1024.0, secs > 0 ? size * 8 / secs / 1000.0 : 0);
+    printf("audio     %.2f s\n", secs);
+    printf("decode    %.2f ms (best of %d)\n", best, iterations);
+    printf("per sec   %.3f ms decode / s audio\n", secs > 0 ? best / secs : 0);
+    printf("realtime  %.1fx\n", best > 0 ? secs * 1000.0 / best : 0);
+    return 0;
+}
@@ -0,0 +1,135 @@
+#pragma once
+// --- Host platform layer ---
+// The part of libctru the core uses, reimplemented for Linux in host.cpp so
+// the same source/ files build and run on a PC. It is the platform interface
+// of the app; the pieces that do real work are
+//   clock       svcGetSystemTick() at the ARM11 rate, from CLOCK_MONOTONIC
+//   threads     Thread, LightLock and LightEvent over pthreads
+//   audio sink  NDSP channel 0, drained at 48 kHz by a simulated DSP thread
+//   input       hid and swkbd, scripted (see host.h)
+// and texture upload lives in citro3d.h. The rest (APT, PTMU, SOC) are
+// stand-ins. Never part of the 3DS build.
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+typedef uint8_t u8; typedef uint16_t u16; typedef uint32_t u32; typedef uint64_t u64;
+typedef int8_t s8; typedef int16_t s16; typedef int32_t s32; typedef int64_t s64;
+typedef s32 Result; typedef u32 Handle;
+
+#define BIT(n) (1U << (n))
+#define U64_MAX UINT64_MAX
+#define R_FAILED(r)    ((s32)(r) < 0)
+#define R_SUCCEEDED(r) ((s32)(r) >= 0)
+
+// --- Clock and threads ---
+#define SYSCLOCK_ARM11    268111856
+#define CUR_THREAD_HANDLE 0xFFFF8000
+
+u64 svcGetSystemTick(void);
+void svcSleepThread(s64 ns);
+Result svcGetThreadPriority(s32* prio, Handle thread);
+u64 osGetTime(void); // ms
+
+typedef struct { pthread_mutex_t m; } LightLock;
+void LightLock_Init(LightLock* l);
+void LightLock_Lock(LightLock* l);
+void LightLock_Unlock(LightLock* l);
+
+typedef enum { RESET_ONESHOT, RESET_STICKY, RESET_PULSE } ResetType;
+typedef struct { pthread_mutex_t m; pthread_cond_t c; int state; u32 pulses; ResetType type; } LightEvent;
+void LightEvent_Init(LightEvent* e, ResetType type);
+void LightEvent_Signal(LightEvent* e);
+void LightEvent_Clear(LightEvent* e);
+void LightEvent_Wait(LightEvent* e);
+int LightEvent_WaitTimeout(LightEvent* e, s64 ns); // 0 when signalled
+
+typedef struct HostThread* Thread;
+typedef void (*ThreadFunc)(void*);
+Thread threadCreate(ThreadFunc entry, void* arg, size_t stack_size, int prio, int core_id, bool detached);
+Result threadJoin(Thread t, u64 timeout_ns);
+void threadFree(Thread t);
+
+// --- Memory ---
+void* linearAlloc(size_t size);
+void linearFree(void* mem);
+u32 linearSpaceFree(void);
+Result DSP_FlushDataCache(const void* addr, u32 size);
+Result GSPGPU_FlushDataCache(const void* addr, u32 size);
+
+// --- Audio sink ---
+enum { NDSP_WBUF_FREE = 0, NDSP_WBUF_QUEUED, NDSP_WBUF_PLAYING, NDSP_WBUF_DONE };
+enum { NDSP_FORMAT_MONO_PCM16 = 0x5, NDSP_FORMAT_STEREO_PCM16 = 0xA };
+
+typedef struct tag_ndspWaveBuf {
+    union { s8* data_pcm8; s16* data_pcm16; u8* data_adpcm; void* data_vaddr; };
+    u32 nsamples;
+    u32 offset;
+    bool looping;
+    volatile u8 status;
+    u16 sequence_id;
+    struct tag_ndspWaveBuf* next;
+} ndspWaveBuf;
+
+typedef void (*ndspCallback)(void* data);
+Result ndspInit(void);
+void ndspExit(void);
+void ndspSetCallback(ndspCallback callback, void* data);
+void ndspChnReset(int id);
+void ndspChnInitParams(int id);
+void ndspChnSetFormat(int id, u16 format);
+void ndspChnSetRate(int id, float rate);
+void ndspChnSetPaused(int id, bool paused);
+bool ndspChnIsPaused(int id);
+bool ndspChnIsPlaying(int id);
+u32 ndspChnGetSamplePos(int id);
+u16 ndspChnGetWaveBufSeq(int id);
+void ndspChnWaveBufAdd(int id, ndspWaveBuf* buf);
+void ndspChnWaveBufClear(int id);
+
+// --- Input ---
+enum {
+    KEY_A = BIT(0), KEY_B = BIT(1), KEY_SELECT = BIT(2), KEY_START = BIT(3),
+    KEY_DRIGHT = BIT(4), KEY_DLEFT = BIT(5), KEY_DUP = BIT(6), KEY_DDOWN = BIT(7),
+    KEY_R = BIT(8), KEY_L = BIT(9), KEY_X = BIT(10), KEY_Y = BIT(11),
+    KEY_ZL = BIT(14), KEY_ZR = BIT(15), KEY_TOUCH = BIT(20),
+};
+typedef struct { u16 px, py; } touchPosition;
+void hidScanInput(void);
+u32 hidKeysDown(void);
+u32 hidKeysHeld(void);
+u32 hidKeysUp(void);
+void hidTouchRead(touchPosition* pos);
+
+typedef enum { SWKBD_TYPE_NORMAL = 0, SWKBD_TYPE_QWERTY, SWKBD_TYPE_NUMPAD, SWKBD_TYPE_WESTERN } SwkbdType;
+typedef enum { SWKBD_PASSWORD_NONE = 0, SWKBD_PASSWORD_HIDE, SWKBD_PASSWORD_HIDE_DELAY } SwkbdPasswordMode;
+typedef enum { SWKBD_BUTTON_NONE = -1, SWKBD_BUTTON_LEFT = 0, SWKBD_BUTTON_MIDDLE, SWKBD_BUTTON_RIGHT, SWKBD_BUTTON_CONFIRM = SWKBD_BUTTON_RIGHT } SwkbdButton;
+typedef struct { const char* hint; const char* initial; } SwkbdState;
+void swkbdInit(SwkbdState* swkbd, SwkbdType type, int num_buttons, int max_text_len);
+void swkbdSetHintText(SwkbdState* swkbd, const char* text);
+void swkbdSetInitialText(SwkbdState* swkbd, const char* text);
+void swkbdSetPasswordMode(SwkbdState* swkbd, SwkbdPasswordMode mode);
+SwkbdButton swkbdInputText(SwkbdState* swkbd, char* buf, size_t buf_size);
+
+// --- System ---
+enum { GFX_TOP = 0, GFX_BOTTOM = 1 };
+enum { GFX_LEFT = 0, GFX_RIGHT = 1 };
+void gfxInitDefault(void);
+void gfxExit(void);
+
+typedef enum { APTHOOK_ONSUSPEND = 0, APTHOOK_ONRESTORE, APTHOOK_ONSLEEP, APTHOOK_ONWAKEUP, APTHOOK_ONEXIT, APTHOOK_COUNT } APT_HookType;
+typedef void (*aptHookFn)(APT_HookType hook, void* param);
+typedef struct tag_aptHookCookie { struct tag_aptHookCookie* next; aptHookFn callback; void* param; } aptHookCookie;
+bool aptMainLoop(void);
+void aptHook(aptHookCookie* cookie, aptHookFn callback, void* param);
+void aptUnhook(aptHookCookie* cookie);
+Result APT_CheckNew3DS(bool* out);
+Result osSetSpeedupEnable(bool enable);
+
+u8 osGetWifiStrength(void); // 0-3
+Result ptmuInit(void);
+void ptmuExit(void);
+Result PTMU_GetBatteryLevel(u8* out); // 0-5
+Result socInit(u32* context_addr, u32 context_size);
+Result socExit(void);
@@ -0,0 +1,39 @@
+#pragma once
+// --- Host platform layer: citro2d ---
+// Drawing is a no-op that only counts calls (see host.h); text is "parsed"
+// by keeping nothing, which is what the cached TextLines are there to avoid.
+// There is no sprite sheet, so the app runs without its icons.
+#include <citro3d.h>
+#include <tex3ds.h>
+
+typedef struct { C3D_Tex* tex; const Tex3DS_SubTexture* subtex; } C2D_Image;
+typedef struct { float topLeft[4], topRight[4], botLeft[4], botRight[4]; } C2D_ImageTint;
+typedef struct C2D_SpriteSheet_s* C2D_SpriteSheet;
+typedef struct C2D_TextBuf_s* C2D_TextBuf;
+typedef struct { C2D_TextBuf buf; size_t begin, end; float width; u32 lines, words; void* font; } C2D_Text;
+
+#define C2D_DEFAULT_MAX_OBJECTS 4096
+enum { C2D_AtBaseline = BIT(0), C2D_WithColor = BIT(1), C2D_AlignLeft = 0, C2D_AlignRight = BIT(2), C2D_AlignCenter = BIT(3) };
+
+static inline u32 C2D_Color32(u8 r, u8 g, u8 b, u8 a) { return r | (g << 8) | (b << 16) | ((u32)a << 24); }
+
+bool C2D_Init(size_t max_objects);
+void C2D_Fini(void);
+void C2D_Prepare(void);
+C3D_RenderTarget* C2D_CreateScreenTarget(int screen, int side);
+void C2D_TargetClear(C3D_RenderTarget* target, u32 color);
+void C2D_SceneBegin(C3D_RenderTarget* target);
+
+C2D_TextBuf C2D_TextBufNew(size_t max_glyphs);
+void C2D_TextBufDelete(C2D_TextBuf buf);
+void C2D_TextBufClear(C2D_TextBuf buf);
+const char* C2D_TextParse(C2D_Text* text, C2D_TextBuf buf, const char* str);
+void C2D_TextOptimize(const C2D_Text* text);
+void C2D_DrawText(const C2D_Text* text, u32 flags, float x, float y, float z, float scale_x, float scale_y, ...);
+
+bool C2D_DrawRectSolid(float x, float y, float z, float w, float h, u32 clr);
+bool C2D_DrawImageAt(C2D_Image img, float x, float y, float depth, const C2D_ImageTint* tint, float scale_x, float scale_y);
+
+C2D_SpriteSheet C2D_SpriteSheetLoad(const char* path);
+void C2D_SpriteSheetFree(C2D_SpriteSheet sheet);
+C2D_Image C2D_SpriteSheetGetImage(C2D_SpriteSheet sheet, size_t index);
@@ -0,0 +1,31 @@
+#pragma once
+// --- Host platform layer: citro3d ---
+// Textures are plain heap memory in the layout the 3DS GPU reads, so the art
+// pipeline's tiling runs unchanged; uploads are counted (see host.h). Frames
+// draw nothing but are paced to 60 Hz like the real vsync.
+#include <3ds.h>
+
+typedef enum { GPU_RGBA8 = 0, GPU_RGB8, GPU_RGBA5551, GPU_RGB565, GPU_RGBA4 } GPU_TEXCOLOR;
+typedef enum { GPU_NEAREST = 0, GPU_LINEAR = 1 } GPU_TEXTURE_FILTER_PARAM;
+
+typedef struct {
+    void* data;
+    GPU_TEXCOLOR fmt;
+    u32 size;
+    u16 width, height;
+} C3D_Tex;
+
+typedef struct C3D_RenderTarget_tag C3D_RenderTarget;
+
+#define C3D_DEFAULT_CMDBUF_SIZE 0x40000
+#define C3D_FRAME_SYNCDRAW      BIT(0)
+#define C3D_FRAME_NONBLOCK      BIT(1)
+
+bool C3D_Init(size_t cmdbuf_size);
+void C3D_Fini(void);
+bool C3D_FrameBegin(u8 flags);
+void C3D_FrameEnd(u8 flags);
+
+bool C3D_TexInit(C3D_Tex* tex, u16 width, u16 height, GPU_TEXCOLOR format);
+void C3D_TexDelete(C3D_Tex* tex);
+void C3D_TexSetFilter(C3D_Tex* tex, GPU_TEXTURE_FILTER_PARAM mag, GPU_TEXTURE_FILTER_PARAM min);
@@ -0,0 +1,403 @@
+#include "host.h"
+#include <citro2d.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+#define DSP_FRAME_NS      (160 * 1000000000LL / 32728) // 160 samples at the DSP's 32728 Hz
+#define DSP_FRAME_SAMPLES (48000.0 * 160 / 32728)      // at the channel's 48 kHz
+
+static HostStats stats;
+
+// The app keeps its files under sdmc:/3ds/JellyCTR and only creates the last level
+__attribute__((constructor)) static void make_sdmc() {
+    mkdir("sdmc:", 0777); mkdir("sdmc:/3ds", 0777); mkdir("sdmc:/3ds/JellyCTR", 0777);
+}
+
+static s64 now_ns() {
+    timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void sleep_until(s64 ns) {
+    timespec ts = { (time_t)(ns / 1000000000), (long)(ns % 1000000000) };
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+HostStats host_get_stats() { return stats; }
+
+// --- Clock and threads ---
+u64 svcGetSystemTick(void) { return (u64)((unsigned __int128)now_ns() * SYSCLOCK_ARM11 / 1000000000); }
+void svcSleepThread(s64 ns) { if (ns > 0) sleep_until(now_ns() + ns); }
+Result svcGetThreadPriority(s32* prio, Handle) { *prio = 0x30; return 0; }
+u64 osGetTime(void) { return now_ns() / 1000000; }
+
+void LightLock_Init(LightLock* l) { pthread_mutex_init(&l->m, NULL); }
+void LightLock_Lock(LightLock* l) { pthread_mutex_lock(&l->m); }
+void LightLock_Unlock(LightLock* l) { pthread_mutex_unlock(&l->m); }
+
+void LightEvent_Init(LightEvent* e, ResetType type) {
+    pthread_condattr_t a; pthread_condattr_init(&a); pthread_condattr_setclock(&a, CLOCK_MONOTONIC);
+    pthread_mutex_init(&e->m, NULL); pthread_cond_init(&e->c, &a); pthread_condattr_destroy(&a);
+    e->state = 0; e->pulses = 0; e->type = type;
+}
+
+// A pulse wakes whoever is waiting and is gone; the others stay set until taken or cleared
+void LightEvent_Signal(LightEvent* e) {
+    pthread_mutex_lock(&e->m);
+    if (e->type == RESET_PULSE) { e->pulses++; pthread_cond_broadcast(&e->c); }
+    else { e->state = 1; if (e->type == RESET_ONESHOT) pthread_cond_signal(&e->c); else pthread_cond_broadcast(&e->c); }
+    pthread_mutex_unlock(&e->m);
+}
+
+void LightEvent_Clear(LightEvent* e) {
+    pthread_mutex_lock(&e->m); e->state = 0; pthread_mutex_unlock(&e->m);
+}
+
+static int event_wait(LightEvent* e, const timespec* until) {
+    pthread_mutex_lock(&e->m);
+    u32 pulses = e->pulses; int err = 0;
+    while (err == 0 && (e->type == RESET_PULSE ? e->pulses == pulses : !e->state))
+        err = until ? pthread_cond_timedwait(&e->c, &e->m, until) : pthread_cond_wait(&e->c, &e->m);
+    if (err == 0 && e->type == RESET_ONESHOT) e->state = 0;
+    pthread_mutex_unlock(&e->m);
+    return err ? 1 : 0;
+}
+
+void LightEvent_Wait(LightEvent* e) { event_wait(e, NULL); }
+
+int LightEvent_WaitTimeout(LightEvent* e, s64 ns) {
+    s64 t = now_ns() + ns;
+    timespec until = { (time_t)(t / 1000000000), (long)(t % 1000000000) };
+    return event_wait(e, &until);
+}
+
+struct HostThread { pthread_t t; ThreadFunc entry; void* arg; bool detached; };
+
+static void* thread_main(void* p) {
+    HostThread* t = (HostThread*)p;
+    t->entry(t->arg);
+    if (t->detached) delete t;
+    return NULL;
+}
+
+// Priorities and cores don't carry over; the host scheduler has plenty of both
+Thread threadCreate(ThreadFunc entry, void* arg, size_t, int, int, bool detached) {
+    HostThread* t = new HostThread;
+    t->entry = entry; t->arg = arg; t->detached = detached;
+    if (pthread_create(&t->t, NULL, thread_main, t) != 0) { delete t; return NULL; }
+    if (detached) pthread_detach(t->t);
+    return t;
+}
+
+Result threadJoin(Thread t, u64) { return pthread_join(t->t, NULL) == 0 ? 0 : -1; }
+void threadFree(Thread t) { if (t && !t->detached) delete t; }
+
+// --- Memory ---
+// Linear memory comes out of the ordinary heap, counted against the 3DS's 32 MB
+#define LINEAR_BYTES 0x2000000
+static size_t linear_used = 0;
+
+void* linearAlloc(size_t size) {
+    void* p = aligned_alloc(0x80, (size + 0x7F) & ~(size_t)0x7F);
+    if (p) __atomic_fetch_add(&linear_used, malloc_usable_size(p), __ATOMIC_RELAXED);
+    return p;
+}
+void linearFree(void* mem) {
+    if (mem) __atomic_fetch_sub(&linear_used, malloc_usable_size(mem), __ATOMIC_RELAXED);
+    free(mem);
+}
+u32 linearSpaceFree(void) {
+    size_t used = __atomic_load_n(&linear_used, __ATOMIC_RELAXED);
+    return used < LINEAR_BYTES ? (u32)(LINEAR_BYTES - used) : 0;
+}
+Result DSP_FlushDataCache(const void*, u32) { return 0; }
+
+// The art pipeline flushes a texture once it is fully written: that is the upload
+Result GSPGPU_FlushDataCache(const void*, u32 size) {
+    __atomic_fetch_add(&stats.tex_uploads, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats.tex_bytes, size, __ATOMIC_RELAXED);
+    return 0;
+}
+
+// --- Audio sink ---
+// One channel. A thread stands in for the DSP: every DSP frame it plays
+// what the frame's worth of samples covers, marks finished waveBufs done
+// and runs the frame callback, like the real one does from its interrupt.
+static struct {
+    pthread_mutex_t m = PTHREAD_MUTEX_INITIALIZER;
+    std::deque<ndspWaveBuf*> queue;
+    u32 pos = 0;            // into queue.front()
+    u16 next_seq = 1, seq = 0;
+    bool paused = false, started = false;
+    ndspCallback callback = NULL;
+    void* callback_data = NULL;
+    pthread_t thread;
+    volatile bool run = false;
+    float speed = -1;
+    FILE* capture = NULL;
+} dsp;
+
+void host_set_dsp_speed(float speed) { dsp.speed = speed; }
+
+// Plays up to budget samples. Lock held.
+static u32 dsp_play(u32 budget) {
+    u32 played = 0;
+    while (played < budget && !dsp.paused && !dsp.queue.empty()) {
+        ndspWaveBuf* wb = dsp.queue.front();
+        wb->status = NDSP_WBUF_PLAYING; dsp.seq = wb->sequence_id;
+        u32 n = wb->nsamples - dsp.pos; if (n > budget - played) n = budget - played;
+        if (dsp.capture) fwrite(wb->data_pcm16 + dsp.pos * 2, 4, n, dsp.capture);
+        dsp.pos += n; played += n;
+        if (dsp.pos >= wb->nsamples) { wb->status = NDSP_WBUF_DONE; dsp.queue.pop_front(); dsp.pos = 0; }
+    }
+    return played;
+}
+
+static void* dsp_thread(void*) {
+    double carry = 0;
+    s64 next = now_ns();
+    while (dsp.run) {
+        float speed = dsp.speed;
+        if (speed > 0) {
+            next += (s64)(DSP_FRAME_NS / speed);
+            s64 now = now_ns();
+            if (next < now - 100000000) next = now; // don't race to catch up after a stall
+            sleep_until(next);
+        }
+        pthread_mutex_lock(&dsp.m);
+        u32 budget;
+        if (speed > 0) { carry += DSP_FRAME_SAMPLES; budget = (u32)carry; carry -= budget; }
+        else budget = dsp.queue.empty() ? 0 : dsp.queue.front()->nsamples - dsp.pos;
+        u32 played = dsp_play(budget);
+        if (!played && dsp.started && !dsp.paused) stats.starved_frames++;
+        stats.samples_played += played; stats.dsp_frames++;
+        ndspCallback cb = dsp.callback; void* data = dsp.callback_data;
+        pthread_mutex_unlock(&dsp.m);
+        if (cb) cb(data);
+        if (speed <= 0 && !played) usleep(500); // nothing to race through
+    }
+    return NULL;
+}
+
+Result ndspInit(void) {
+    if (dsp.speed < 0) { const char* s = getenv("JELLYCTR_DSP_SPEED"); dsp.speed = s ? atof(s) : 1; }
+    const char* cap = getenv("JELLYCTR_PCM");
+    if (cap && !(dsp.capture = fopen(cap, "wb"))) fprintf(stderr, "host: can't write %s\n", cap);
+    dsp.run = true;
+    return pthread_create(&dsp.thread, NULL, dsp_thread, NULL) == 0 ? 0 : -1;
+}
+
+void ndspExit(void) {
+    if (!dsp.run) return;
+    dsp.run = false; pthread_join(dsp.thread, NULL);
+    if (dsp.capture) { fclose(dsp.capture); dsp.capture = NULL; }
+}
+
+void ndspSetCallback(ndspCallback callback, void* data) {
+    pthread_mutex_lock(&dsp.m); dsp.callback = callback; dsp.callback_data = data; pthread_mutex_unlock(&dsp.m);
+}
+
+void ndspChnWaveBufClear(int) {
+    pthread_mutex_lock(&dsp.m);
+    dsp.queue.clear(); dsp.pos = 0; dsp.started = false;
+    pthread_mutex_unlock(&dsp.m);
+}
+
+void ndspChnReset(int id) {
+    ndspChnWaveBufClear(id);
+    pthread_mutex_lock(&dsp.m); dsp.paused = false; pthread_mutex_unlock(&dsp.m);
+}
+
+void ndspChnInitParams(int) {}
+void ndspChnSetFormat(int, u16) {}
+void ndspChnSetRate(int, float) {}
+
+void ndspChnSetPaused(int, bool paused) {
+    pthread_mutex_lock(&dsp.m); dsp.paused = paused; pthread_mutex_unlock(&dsp.m);
+}
+
+bool ndspChnIsPaused(int) { return dsp.paused; }
+bool ndspChnIsPlaying(int) { return !dsp.queue.empty(); }
+u32 ndspChnGetSamplePos(int) { return dsp.pos; }
+u16 ndspChnGetWaveBufSeq(int) { return dsp.seq; }
+
+void ndspChnWaveBufAdd(int, ndspWaveBuf* buf) {
+    pthread_mutex_lock(&dsp.m);
+    buf->status = NDSP_WBUF_QUEUED; buf->sequence_id = dsp.next_seq++;
+    if (!dsp.next_seq) dsp.next_seq = 1;
+    dsp.queue.push_back(buf); dsp.started = true;
+    pthread_mutex_unlock(&dsp.m);
+}
+
+// --- Input ---
+struct ScriptLine { u32 frame, frames, keys; u16 x, y; };
+static std::vector<ScriptLine> script;
+static std::vector<std::string> answers;
+static u32 hid_frame = 0, keys_held = 0, keys_prev = 0;
+static touchPosition touch;
+
+static const struct { const char* name; u32 key; } key_names[] = {
+    { "A", KEY_A }, { "B", KEY_B }, { "X", KEY_X }, { "Y", KEY_Y }, { "L", KEY_L }, { "R", KEY_R },
+    { "ZL", KEY_ZL }, { "ZR", KEY_ZR }, { "START", KEY_START }, { "SELECT", KEY_SELECT },
+    { "DUP", KEY_DUP }, { "DDOWN", KEY_DDOWN }, { "DLEFT", KEY_DLEFT }, { "DRIGHT", KEY_DRIGHT },
+};
+
+static void load_script(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) { fprintf(stderr, "host: can't read %s\n", path); return; }
+    char line[256];
+    for (int n = 1; fgets(line, sizeof(line), f); n++) {
+        char* hash = strchr(line, '#'); if (hash) *hash = '\0';
+        ScriptLine s = {}; char keys[128];
+        if (sscanf(line, "%u %u %127s", &s.frame, &s.frames, keys) != 3) continue;
+        for (char* k = strtok(keys, "+"); k; k = strtok(NULL, "+")) {
+            unsigned x, y; u32 bit = 0;
+            if (sscanf(k, "TOUCH@%u,%u", &x, &y) == 2) { bit = KEY_TOUCH; s.x = x; s.y = y; }
+            for (size_t i = 0; i < sizeof(key_names) / sizeof(key_names[0]); i++) if (!strcasecmp(k, key_names[i].name)) bit = key_names[i].key;
+            if (!bit) fprintf(stderr, "host: %s:%d: unknown key %s\n", path, n, k);
+            s.keys |= bit;
+        }
+        script.push_back(s);
+    }
+    fclose(f);
+}
+
+void hidScanInput(void) {
+    if (hid_frame == 0) {
+        const char* path = getenv("JELLYCTR_INPUT");
+        if (path) load_script(path);
+    }
+    keys_prev = keys_held; keys_held = 0;
+    for (const ScriptLine& s : script) {
+        if (hid_frame < s.frame || hid_frame >= s.frame + (s.frames ? s.frames : 1)) continue;
+        keys_held |= s.keys;
+        if (s.keys & KEY_TOUCH) { touch.px = s.x; touch.py = s.y; }
+    }
+    hid_frame++;
+}
+
+u32 hidKeysDown(void) { return keys_held & ~keys_prev; }
+u32 hidKeysHeld(void) { return keys_held; }
+u32 hidKeysUp(void) { return keys_prev & ~keys_held; }
+void hidTouchRead(touchPosition* pos) { *pos = touch; }
+
+void swkbdInit(SwkbdState* swkbd, SwkbdType, int, int) {
+    swkbd->hint = swkbd->initial = "";
+    static bool loaded = false;
+    const char* text = getenv("JELLYCTR_TEXT");
+    if (loaded || !text) return;
+    loaded = true;
+    for (const char* p = text;; p++) {
+        const char* bar = strchr(p, '|');
+        answers.push_back(std::string(p, bar ? bar - p : strlen(p)));
+        if (!bar) break;
+        p = bar;
+    }
+}
+
+void swkbdSetHintText(SwkbdState* swkbd, const char* text) { swkbd->hint = text; }
+void swkbdSetInitialText(SwkbdState* swkbd, const char* text) { swkbd->initial = text; }
+void swkbdSetPasswordMode(SwkbdState*, SwkbdPasswordMode) {}
+
+// Answers in order; once they run out the keyboard is cancelled
+SwkbdButton swkbdInputText(SwkbdState* swkbd, char* buf, size_t buf_size) {
+    if (answers.empty()) { fprintf(stderr, "host: keyboard \"%s\" cancelled\n", swkbd->hint); return SWKBD_BUTTON_LEFT; }
+    snprintf(buf, buf_size, "%s", answers.front().c_str());
+    answers.erase(answers.begin());
+    return SWKBD_BUTTON_CONFIRM;
+}
+
+// --- System ---
+void gfxInitDefault(void) {}
+void gfxExit(void) {}
+
+bool aptMainLoop(void) { return true; }
+void aptHook(aptHookCookie* cookie, aptHookFn callback, void* param) { cookie->next = NULL; cookie->callback = callback; cookie->param = param; }
+void aptUnhook(aptHookCookie*) {}
+Result APT_CheckNew3DS(bool* out) { *out = true; return 0; }
+Result osSetSpeedupEnable(bool) { return 0; }
+
+u8 osGetWifiStrength(void) { return 3; }
+Result ptmuInit(void) { return 0; }
+void ptmuExit(void) {}
+Result PTMU_GetBatteryLevel(u8* out) { *out = 5; return 0; }
+Result socInit(u32*, u32) { return 0; }
+Result socExit(void) { return 0; }
+
+// --- citro3d ---
+struct C3D_RenderTarget_tag { int screen; };
+static C3D_RenderTarget targets[2] = { { GFX_TOP }, { GFX_BOTTOM } };
+static int paced = -1;
+static s64 frame_due = 0;
+
+void host_set_paced(bool on) { paced = on; }
+
+bool C3D_Init(size_t) {
+    if (paced < 0) paced = getenv("JELLYCTR_UNPACED") == NULL;
+    return true;
+}
+
+void C3D_Fini(void) {}
+
+bool C3D_FrameBegin(u8) {
+    if (paced > 0) {
+        s64 now = now_ns();
+        if (frame_due < now - 100000000) frame_due = now;
+        sleep_until(frame_due);
+        frame_due += 1000000000 / 60;
+    }
+    return true;
+}
+
+void C3D_FrameEnd(u8) { stats.frames++; }
+
+static u32 texel_bytes(GPU_TEXCOLOR fmt) { return fmt == GPU_RGBA8 ? 4 : fmt == GPU_RGB8 ? 3 : 2; }
+
+bool C3D_TexInit(C3D_Tex* tex, u16 width, u16 height, GPU_TEXCOLOR format) {
+    tex->size = (u32)width * height * texel_bytes(format);
+    tex->data = linearAlloc(tex->size);
+    tex->width = width; tex->height = height; tex->fmt = format;
+    return tex->data != NULL;
+}
+
+void C3D_TexDelete(C3D_Tex* tex) { linearFree(tex->data); tex->data = NULL; }
+void C3D_TexSetFilter(C3D_Tex*, GPU_TEXTURE_FILTER_PARAM, GPU_TEXTURE_FILTER_PARAM) {}
+
+// --- citro2d ---
+struct C2D_TextBuf_s { size_t max_glyphs; };
+
+bool C2D_Init(size_t) { return true; }
+void C2D_Fini(void) {}
+void C2D_Prepare(void) {}
+C3D_RenderTarget* C2D_CreateScreenTarget(int screen, int) { return &targets[screen == GFX_BOTTOM]; }
+void C2D_TargetClear(C3D_RenderTarget*, u32) {}
+void C2D_SceneBegin(C3D_RenderTarget*) {}
+
+C2D_TextBuf C2D_TextBufNew(size_t max_glyphs) { C2D_TextBuf b = new C2D_TextBuf_s; b->max_glyphs = max_glyphs; return b; }
+void C2D_TextBufDelete(C2D_TextBuf buf) { delete buf; }
+void C2D_TextBufClear(C2D_TextBuf) {}
+
+const char* C2D_TextParse(C2D_Text* text, C2D_TextBuf buf, const char* str) {
+    size_t n = strlen(str);
+    memset(text, 0, sizeof(*text));
+    text->buf = buf; text->end = n; text->width = n * 8.0f; text->lines = 1;
+    return str + n;
+}
+
+void C2D_TextOptimize(const C2D_Text*) {}
+void C2D_DrawText(const C2D_Text*, u32, float, float, float, float, float, ...) { stats.draw_calls++; }
+bool C2D_DrawRectSolid(float, float, float, float, float, u32) { stats.draw_calls++; return true; }
+bool C2D_DrawImageAt(C2D_Image, float, float, float, const C2D_ImageTint*, float, float) { stats.draw_calls++; return true; }
+
+C2D_SpriteSheet C2D_SpriteSheetLoad(const char*) { return NULL; }
+void C2D_SpriteSheetFree(C2D_SpriteSheet) {}
+C2D_Image C2D_SpriteSheetGetImage(C2D_SpriteSheet, size_t) { C2D_Image img = { NULL, NULL }; return img; }
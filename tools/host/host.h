@@ -0,0 +1,27 @@
+#pragma once
+#include <3ds.h>
+
+// --- Host platform layer: controls ---
+// What the stand-in backends did, and knobs for benchmarks. The headless app
+// (tools/jellyctr_host) takes the same settings from the environment:
+//   JELLYCTR_INPUT      input script, one "<frame> <frames> <keys>" per line;
+//                       keys are joined with '+', e.g. "A", "DDOWN+R",
+//                       "TOUCH@160,120"; '#' starts a comment
+//   JELLYCTR_TEXT       keyboard answers, '|'-separated, used in order
+//   JELLYCTR_PCM        file to capture playback to, raw s16le stereo 48 kHz
+//   JELLYCTR_DSP_SPEED  DSP clock multiplier; 0 plays each buffer as soon as it's queued
+//   JELLYCTR_UNPACED    set to run frames back to back instead of at 60 Hz
+// The SD card is the directory "sdmc:" under the working directory.
+struct HostStats {
+    u64 dsp_frames;       // simulated DSP frames
+    u64 samples_played;
+    u64 starved_frames;   // frames the channel was unpaused with nothing queued
+    u32 tex_uploads;      // textures flushed to the GPU
+    u64 tex_bytes;
+    u32 frames;           // C3D frames ended
+    u32 draw_calls;       // C2D draws, all frames
+};
+
+void host_set_dsp_speed(float speed); // before ndspInit()
+void host_set_paced(bool paced);      // 60 Hz frame pacing
+HostStats host_get_stats();
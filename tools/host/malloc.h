@@ -0,0 +1,6 @@
+#pragma once
+// newlib's mallinfo() is glibc's deprecated one; glibc's replacement has the same fields
+#include_next <malloc.h>
+
+static inline struct mallinfo2 host_mallinfo() { return mallinfo2(); }
+#define mallinfo host_mallinfo
@@ -0,0 +1,5 @@
+#pragma once
+// --- Host platform layer: tex3ds ---
+#include <citro3d.h>
+
+typedef struct { u16 width, height; float left, top, right, bottom; } Tex3DS_SubTexture;
@@ -0,0 +1,252 @@
+#!/usr/bin/env python3
+"""Mock Jellyfin server for running and benchmarking JellyCTR on a PC.
+
+Serves a synthetic music library, answering only what the app asks:
+  POST /Users/AuthenticateByName   any user name and password
+  GET  /Items                      albums (IncludeItemTypes=MusicAlbum) or tracks
+                                   (IncludeItemTypes=Audio, or ParentId=<album>), with
+                                   StartIndex/Limit, SearchTerm and MinDateLastSaved
+  GET  /Items/<id>/Images/Primary  <assets>/cover.jpg, else the one next to this script
+  GET  /Audio/<id>/stream          container=raw is generated PCM, a steady tone per
+                                   track, from StartTimeTicks on; other containers are
+                                   <assets>/track.<container> or 404, which makes the
+                                   app fall back to PCM
+
+Every response waits --latency ms before its headers and is paced to
+--bandwidth kB/s, per connection. Stdlib only.
+"""
+import argparse
+import array
+import json
+import math
+import os
+import random
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+RATE = 48000
+FRAME_BYTES = 4  # stereo s16
+TICKS = 10000000  # Jellyfin ticks per second
+CHUNK = 16 * 1024
+
+WORDS = ("Blue Night Electric Garden Live Rock Dreams Kind Glass River Static Silver Echo Paper "
+         "Northern Lights Hollow Signal Winter Ocean Golden Machine Velvet Ghost Summer Empire").split()
+ACCENTED = ("Björk", "Sigur Rós", "Motörhead", "Café", "Señor", "Straße", "Ænima")
+
+
+class Library:
+    def __init__(self, albums, tracks, seed):
+        rnd = random.Random(seed)
+        self.albums, self.tracks, self.by_id = [], [], {}
+        for a in range(albums):
+            n = rnd.randint(1, 3)
+            name = " ".join(rnd.choice(WORDS) for _ in range(n))
+            if rnd.random() < 0.1:
+                name = rnd.choice(ACCENTED) + " " + name
+            if rnd.random() < 0.15:
+                name = "The " + name
+            album = {
+                "Name": name, "Id": "a%031x" % a, "Type": "MusicAlbum",
+                "AlbumArtist": rnd.choice(WORDS) + " " + rnd.choice(WORDS),
+                "DateLastSaved": "2024-01-01T%02d:%02d:00.0000000Z" % (a // 60 % 24, a % 60),
+                "tracks": [],
+            }
+            for t in range(tracks):
+                seconds = 120 + rnd.randint(0, 180)
+                track = {
+                    "Name": "%s %s" % (rnd.choice(WORDS), rnd.choice(WORDS)),
+                    "Id": "b%015x%016x" % (a, t), "Type": "Audio",
+                    "Album": name, "AlbumId": album["Id"], "IndexNumber": t + 1, "ParentIndexNumber": 1,
+                    "RunTimeTicks": seconds * TICKS, "DateLastSaved": album["DateLastSaved"],
+                    "tone": 220 + (a * 7 + t * 31) % 440,
+                }
+                album["tracks"].append(track)
+                self.tracks.append(track)
+                self.by_id[track["Id"]] = track
+            album["RunTimeTicks"] = sum(t["RunTimeTicks"] for t in album["tracks"])
+            self.albums.append(album)
+            self.by_id[album["Id"]] = album
+        self.albums.sort(key=lambda a: sort_name(a["Name"]))
+
+    def query(self, q):
+        parent = q.get("ParentId")
+        if parent:
+            album = self.by_id.get(parent.replace("-", "").lower())
+            items = album["tracks"] if album and album["Type"] == "MusicAlbum" else []
+        elif q.get("IncludeItemTypes") == "MusicAlbum":
+            items = self.albums
+        else:
+            items = self.tracks
+        term = q.get("SearchTerm", "").lower()
+        if term:
+            items = [i for i in items if term in i["Name"].lower()]
+        # Newer than, so a re-sync with nothing changed comes back empty
+        since = q.get("MinDateLastSaved")
+        if since:
+            items = [i for i in items if i["DateLastSaved"] > since]
+        start = int(q.get("StartIndex", 0))
+        limit = int(q.get("Limit", len(items)))
+        page = [public(i) for i in items[start:start + limit]]
+        return {"Items": page, "TotalRecordCount": len(items), "StartIndex": start}
+
+
+def sort_name(name):
+    lower = name.lower()
+    for article in ("the ", "a ", "an "):
+        if lower.startswith(article):
+            return lower[len(article):]
+    return lower
+
+
+def public(item):
+    return {k: v for k, v in item.items() if k not in ("tracks", "tone")}
+
+
+_tones = {}
+_tones_lock = threading.Lock()
+
+
+def tone(freq):
+    """One second of a freq Hz sine, stereo s16le; whole cycles, so it loops cleanly."""
+    with _tones_lock:
+        if freq not in _tones:
+            samples = array.array("h")
+            for i in range(RATE):
+                v = int(6000 * math.sin(2 * math.pi * freq * i / RATE))
+                samples.append(v)
+                samples.append(v)
+            if sys.byteorder != "little":
+                samples.byteswap()
+            _tones[freq] = samples.tobytes()
+        return _tones[freq]
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    server_version = "MockJellyfin/1.0"
+    disable_nagle_algorithm = True  # headers and body go out in separate writes
+
+    def log_message(self, fmt, *args):
+        if self.server.opts.verbose:
+            BaseHTTPRequestHandler.log_message(self, fmt, *args)
+
+    def begin(self, status, ctype, length):
+        if self.server.opts.latency:
+            time.sleep(self.server.opts.latency / 1000.0)
+        self.send_response(status)
+        self.send_header("Content-Type", ctype)
+        self.send_header("Content-Length", str(length))
+        self.end_headers()
+
+    def send_paced(self, chunks):
+        bw = self.server.opts.bandwidth * 1024
+        t0, sent = time.monotonic(), 0
+        try:
+            for chunk in chunks:
+                self.wfile.write(chunk)
+                sent += len(chunk)
+                if bw:
+                    ahead = sent / bw - (time.monotonic() - t0)
+                    if ahead > 0:
+                        time.sleep(ahead)
+        except (BrokenPipeError, ConnectionResetError):
+            self.close_connection = True  # the app cancels streams and art all the time
+
+    def reply(self, status, ctype, body):
+        self.begin(status, ctype, len(body))
+        self.send_paced(body[i:i + CHUNK] for i in range(0, len(body), CHUNK))
+
+    def reply_json(self, obj):
+        self.reply(200, "application/json", json.dumps(obj).encode())
+
+    def not_found(self):
+        self.reply(404, "text/plain", b"not found\n")
+
+    def do_POST(self):
+        length = int(self.headers.get("Content-Length", 0))
+        body = self.rfile.read(length) if length else b""
+        if urlparse(self.path).path.rstrip("/").endswith("/Users/AuthenticateByName"):
+            try:
+                user = json.loads(body or b"{}").get("Username", "")
+            except ValueError:
+                user = ""
+            self.reply_json({"AccessToken": "mocktoken", "ServerId": "mock", "User": {"Name": user, "Id": "c%031x" % 1}})
+        else:
+            self.not_found()
+
+    def do_GET(self):
+        url = urlparse(self.path)
+        q = {k: v[0] for k, v in parse_qs(url.query).items()}
+        parts = [p for p in url.path.split("/") if p]
+        lib = self.server.library
+        if parts == ["Items"]:
+            self.reply_json(lib.query(q))
+        elif len(parts) == 4 and parts[0] == "Items" and parts[2] == "Images":
+            self.reply(200, "image/jpeg", self.server.cover)
+        elif len(parts) == 3 and parts[0] == "Audio" and parts[2] == "stream":
+            self.stream(lib.by_id.get(parts[1].replace("-", "").lower()), q)
+        else:
+            self.not_found()
+
+    def stream(self, track, q):
+        if not track or track["Type"] != "Audio":
+            return self.not_found()
+        container = q.get("container", "raw")
+        if container != "raw":
+            path = os.path.join(self.server.opts.assets or "", "track." + container)
+            if not self.server.opts.assets or not os.path.isfile(path):
+                return self.not_found()
+            with open(path, "rb") as f:
+                return self.reply(200, "audio/" + container, f.read())
+        total = track["RunTimeTicks"] * RATE // TICKS
+        start = min(int(q.get("StartTimeTicks", 0)) * RATE // TICKS, total)
+        length = (total - start) * FRAME_BYTES
+        second = tone(track["tone"])
+
+        def chunks():
+            pos = (start % RATE) * FRAME_BYTES
+            left = length
+            while left:
+                n = min(CHUNK, left, len(second) - pos)
+                yield second[pos:pos + n]
+                pos = (pos + n) % len(second)
+                left -= n
+        self.begin(200, "audio/L16", length)
+        self.send_paced(chunks())
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--port", type=int, default=8096)
+    ap.add_argument("--albums", type=int, default=500)
+    ap.add_argument("--tracks", type=int, default=12, help="tracks per album")
+    ap.add_argument("--latency", type=float, default=0, help="ms before each response")
+    ap.add_argument("--bandwidth", type=float, default=0, help="kB/s per connection, 0 for unlimited")
+    ap.add_argument("--assets", help="directory with cover.jpg and track.ogg/.mp3/.flac")
+    ap.add_argument("--seed", type=int, default=1)
+    ap.add_argument("-v", "--verbose", action="store_true")
+    opts = ap.parse_args()
+
+    srv = ThreadingHTTPServer(("127.0.0.1", opts.port), Handler)
+    srv.daemon_threads = True
+    srv.opts = opts
+    srv.library = Library(opts.albums, opts.tracks, opts.seed)
+    cover = os.path.join(opts.assets or "", "cover.jpg")
+    if not opts.assets or not os.path.isfile(cover):
+        cover = os.path.join(os.path.dirname(os.path.abspath(__file__)), "cover.jpg")
+    with open(cover, "rb") as f:
+        srv.cover = f.read()
+    print("mock Jellyfin on http://127.0.0.1:%d: %d albums, %d tracks, latency %g ms, bandwidth %s"
+          % (opts.port, len(srv.library.albums), len(srv.library.tracks), opts.latency,
+             "%g kB/s" % opts.bandwidth if opts.bandwidth else "unlimited"), flush=True)
+    try:
+        srv.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,73 @@
+// Host-side search timing.
+//   search_bench [items] [query]
+// Builds a SearchIndex over a synthetic list of accented names and times the
+// build and each keystroke of typing query, the way the list filter runs it:
+// every keystroke narrows the previous result. A 3DS frame is 16.7 ms and the
+// ARM11 is very roughly 10x slower than a desktop core, so per-keystroke
+// times should stay well under a millisecond here.
+#include "search.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_ms() {
+    timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static const char* const words[] = {
+    "Björk", "Sigur Rós", "Motörhead", "Beyoncé", "Café", "Ænima", "Łódź", "Straße", "Don't", "Stop",
+    "The", "Night", "Blue", "Živa", "Señor", "Øya", "Live", "at", "the", "Garden", "Rock", "Dreams",
+    "Electric", "Ladyland", "Kind", "of", "Blue", "Hörspiel", "Über", "Alles", "Crème", "Brûlée",
+};
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 5000;
+    const char* query = argc > 2 ? argv[2] : "sigur ros live";
+    const int nw = sizeof(words) / sizeof(words[0]);
+
+    StringArena arena; ItemList list(&arena);
+    ItemId id = {};
+    srand(1);
+    for (int i = 0; i < n; i++) {
+        char name[128] = "";
+        int len = 1 + rand() % 4;
+        for (int w = 0; w < len; w++) { if (w) strcat(name, " "); strcat(name, words[rand() % nw]); }
+        snprintf(name + strlen(name), sizeof(name) - strlen(name), " %d", i);
+        memcpy(id.b, &i, sizeof(i));
+        list.push(id, name, "", ItemId(), 0);
+    }
+
+    std::string f;
+    const char* samples[] = { "Björk", "Sigur Rós", "Straße", "Ænima", "Don't Stop", "AC/DC — Live!" };
+    for (const char* s : samples) { search_fold(s, f); printf("fold %-16s -> \"%s\"\n", s, f.c_str()); }
+
+    SearchIndex ix;
+    double t0 = now_ms();
+    ix.build(list);
+    printf("build: %d items, %zu words, %.2f ms, %zu bytes\n", n, ix.words.size(), now_ms() - t0, ix.bytes());
+    for (int b = 0; b < SEARCH_BUCKETS; b++) if (ix.first[b] >= 0) printf("%s:%d ", search_bucket_label(b), ix.first[b]);
+    printf("\n");
+
+    // Type the query a character at a time
+    std::vector<int> prev, hits;
+    char typed[128] = "";
+    for (size_t i = 0; query[i] && i < sizeof(typed) - 1; i++) {
+        typed[i] = query[i]; typed[i + 1] = '\0';
+        t0 = now_ms();
+        search_match(ix, typed, hits, i ? &prev : NULL);
+        double ms = now_ms() - t0;
+        printf("%-20s %6zu hits  %.3f ms\n", typed, hits.size(), ms);
+        // Narrowing must agree with a fresh search
+        std::vector<int> fresh; search_match(ix, typed, fresh);
+        if (fresh != hits) { printf("MISMATCH against a fresh search (%zu)\n", fresh.size()); return 1; }
+        prev.swap(hits);
+    }
+    // What every keystroke would cost without the word index
+    t0 = now_ms();
+    size_t scanned = 0;
+    for (size_t i = 0; i < ix.size(); i++) if (strstr(ix.key(i), "ros")) scanned++;
+    printf("substring scan for comparison: %zu hits  %.3f ms\n", scanned, now_ms() - t0);
+    return 0;
+}
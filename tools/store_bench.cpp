@@ -0,0 +1,94 @@
+// Host-side library memory report.
+//   store_bench [albums] [tracks_per_album]
+// Builds the same synthetic library as the old vector<MusicItem> of
+// std::strings and as an ItemList over a StringArena, counting every heap
+// byte through operator new, and reports bytes per item and the cost of the
+// list copy a navigation does.
+#include "store.h"
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <time.h>
+
+static size_t live_bytes = 0, live_blocks = 0;
+
+void* operator new(size_t n) {
+    size_t* p = (size_t*)malloc(n + sizeof(size_t));
+    if (!p) throw std::bad_alloc();
+    *p = n; live_bytes += n; live_blocks++;
+    return p + 1;
+}
+void operator delete(void* q) noexcept {
+    if (!q) return;
+    size_t* p = (size_t*)q - 1;
+    live_bytes -= *p; live_blocks--;
+    free(p);
+}
+void operator delete(void* q, size_t) noexcept { operator delete(q); }
+
+// What main.cpp held before the store
+struct LegacyItem {
+    std::string Name, Id, Album, AlbumId;
+    int64_t DurationTicks;
+};
+
+static double now_ms() {
+    timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void make_id(char* out, unsigned a, unsigned b) { snprintf(out, ITEM_ID_HEX, "%08x%08x%08x%08x", a * 2654435761u, b, a ^ 0x5bd1e995u, b * 40503u); }
+
+struct Measure { size_t bytes, blocks; double build_ms, copy_ms; };
+
+static Measure measure_legacy(int albums, int tracks) {
+    size_t b0 = live_bytes, k0 = live_blocks; double t0 = now_ms();
+    std::vector<LegacyItem>* list = new std::vector<LegacyItem>;
+    for (int a = 0; a < albums; a++) {
+        char album_id[ITEM_ID_HEX], id[ITEM_ID_HEX], album[64], name[64];
+        make_id(album_id, a, 0); snprintf(album, sizeof(album), "Some Album Title No. %d", a);
+        for (int t = 0; t < tracks; t++) {
+            make_id(id, a, t + 1); snprintf(name, sizeof(name), "Track Name Of Typical Length %d", t);
+            LegacyItem it; it.Name = name; it.Id = id; it.Album = album; it.AlbumId = album_id; it.DurationTicks = 2400000000LL;
+            list->push_back(it);
+        }
+    }
+    Measure m; m.build_ms = now_ms() - t0; m.bytes = live_bytes - b0; m.blocks = live_blocks - k0;
+    t0 = now_ms(); { std::vector<LegacyItem> copy = *list; } m.copy_ms = now_ms() - t0;
+    delete list;
+    return m;
+}
+
+static Measure measure_store(int albums, int tracks) {
+    size_t b0 = live_bytes, k0 = live_blocks; double t0 = now_ms();
+    StringArena* arena = new StringArena;
+    ItemList* list = new ItemList(arena);
+    for (int a = 0; a < albums; a++) {
+        char hex[ITEM_ID_HEX], album[64], name[64]; ItemId album_id, id;
+        make_id(hex, a, 0); item_id_parse(&album_id, hex); snprintf(album, sizeof(album), "Some Album Title No. %d", a);
+        for (int t = 0; t < tracks; t++) {
+            make_id(hex, a, t + 1); item_id_parse(&id, hex); snprintf(name, sizeof(name), "Track Name Of Typical Length %d", t);
+            list->push(id, name, album, album_id, 240000);
+        }
+    }
+    Measure m; m.build_ms = now_ms() - t0; m.bytes = live_bytes - b0; m.blocks = live_blocks - k0;
+    t0 = now_ms(); { ItemList copy = *list; } m.copy_ms = now_ms() - t0;
+    delete list; delete arena;
+    return m;
+}
+
+static void report(const char* label, const Measure& m, size_t items) {
+    printf("%-8s %8.1f bytes/item  %6.2f blocks/item  build %7.2f ms  copy %6.2f ms\n",
+           label, (double)m.bytes / items, (double)m.blocks / items, m.build_ms, m.copy_ms);
+}
+
+int main(int argc, char** argv) {
+    int albums = argc > 1 ? atoi(argv[1]) : 2000, tracks = argc > 2 ? atoi(argv[2]) : 12;
+    size_t items = (size_t)albums * tracks;
+    if (!items) { fprintf(stderr, "usage: store_bench [albums] [tracks_per_album]\n"); return 1; }
+    printf("%d albums x %d tracks = %zu items (%zu-bit host; blocks also pay allocator headers)\n", albums, tracks, items, sizeof(void*) * 8);
+    report("legacy", measure_legacy(albums, tracks), items);
+    report("store", measure_store(albums, tracks), items);
+    return 0;
+}
@@ -0,0 +1,80 @@
+// Host-side converter from the app's trace log to Chrome trace JSON.
+//   trace2json trace.bin [out.json]
+// trace.bin is sdmc:/3ds/JellyCTR/trace.bin, written with trace=1 in
+// config.txt; trace.prev.bin beside it is the session before. Open the JSON
+// in chrome://tracing or ui.perfetto.dev: spans show on one row per thread,
+// counters as graphs. Event and lane names come from the file, so an older
+// trace converts with a newer build of this.
+#include "trace.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+struct Event { TraceType type; std::string name; };
+
+// Names as stored: NUL-terminated, with a type byte before each event's
+static bool read_names(const unsigned char* block, const TraceHeader& h, std::vector<Event>& events, std::vector<std::string>& lanes) {
+    size_t at = sizeof(TraceHeader), end = TRACE_HEADER_BYTES;
+    for (uint32_t i = 0; i < h.event_count; i++) {
+        if (at >= end) return false;
+        Event e; e.type = (TraceType)block[at++];
+        size_t n = strnlen((const char*)block + at, end - at);
+        if (at + n >= end) return false;
+        e.name.assign((const char*)block + at, n); at += n + 1;
+        events.push_back(e);
+    }
+    for (uint32_t i = 0; i < h.lane_count; i++) {
+        size_t n = at < end ? strnlen((const char*)block + at, end - at) : 0;
+        if (at + n >= end) return false;
+        lanes.push_back(std::string((const char*)block + at, n)); at += n + 1;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) { fprintf(stderr, "usage: %s trace.bin [out.json]\n", argv[0]); return 2; }
+    FILE* in = fopen(argv[1], "rb");
+    if (!in) { perror(argv[1]); return 1; }
+    unsigned char block[TRACE_HEADER_BYTES];
+    TraceHeader h;
+    if (fread(block, 1, sizeof(block), in) != sizeof(block)) { fprintf(stderr, "%s: too short\n", argv[1]); return 1; }
+    memcpy(&h, block, sizeof(h));
+    if (h.magic != TRACE_MAGIC || h.version != TRACE_VERSION || h.record_bytes != sizeof(TraceRecord) || !h.capacity) {
+        fprintf(stderr, "%s: not a version %d trace\n", argv[1], TRACE_VERSION); return 1;
+    }
+    std::vector<Event> events; std::vector<std::string> lanes;
+    if (!read_names(block, h, events, lanes)) { fprintf(stderr, "%s: bad name table\n", argv[1]); return 1; }
+
+    // The file is a ring: the oldest surviving record sits just after the newest
+    uint64_t n = h.written < h.capacity ? h.written : h.capacity;
+    std::vector<TraceRecord> slots(h.capacity);
+    size_t got = fread(slots.data(), sizeof(TraceRecord), h.capacity, in);
+    fclose(in);
+    if (got < n) { fprintf(stderr, "%s: truncated, %zu of %llu records\n", argv[1], got, (unsigned long long)n); n = got; }
+
+    FILE* out = argc > 2 ? fopen(argv[2], "w") : stdout;
+    if (!out) { perror(argv[2]); return 1; }
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (size_t i = 0; i < lanes.size(); i++)
+        fprintf(out, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"%s\"}},\n", i, lanes[i].c_str());
+    fprintf(out, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"args\":{\"name\":\"JellyCTR\"}}");
+    uint32_t skipped = 0;
+    for (uint64_t i = 0; i < n; i++) {
+        const TraceRecord& r = slots[(h.written - n + i) % h.capacity];
+        if (r.event >= events.size() || r.lane >= lanes.size()) { skipped++; continue; }
+        const Event& e = events[r.event];
+        fprintf(out, ",\n{\"name\":\"%s\",\"pid\":1,\"tid\":%u,\"ts\":%llu,", e.name.c_str(), r.lane, (unsigned long long)r.t_us);
+        switch (e.type) {
+        case TRACE_SPAN:    fprintf(out, "\"ph\":\"X\",\"dur\":%u,\"args\":{\"arg\":%u}}", r.value, r.arg); break;
+        case TRACE_INSTANT: fprintf(out, "\"ph\":\"i\",\"s\":\"t\",\"args\":{\"arg\":%u}}", r.arg); break;
+        default:            fprintf(out, "\"ph\":\"C\",\"args\":{\"%s\":%u}}", e.name.c_str(), r.value); break;
+        }
+    }
+    fprintf(out, "\n]}\n");
+    if (out != stdout) fclose(out);
+    fprintf(stderr, "%llu records%s", (unsigned long long)n, h.written > h.capacity ? " (the log wrapped; older ones are gone)" : "");
+    if (skipped) fprintf(stderr, ", %u unknown skipped", skipped);
+    fprintf(stderr, "\n");
+    return 0;
+}